@@ -0,0 +1,55 @@
+#include "my_web_socket/broadcaster.hxx"
+#include <algorithm>
+
+namespace my_web_socket
+{
+
+template <class T>
+void
+Broadcaster<T>::subscribe (std::shared_ptr<MyWebSocket<T> > const &myWebSocket)
+{
+  subscribers.push_back (myWebSocket);
+}
+
+template <class T>
+void
+Broadcaster<T>::unsubscribe (std::shared_ptr<MyWebSocket<T> > const &myWebSocket)
+{
+  std::erase_if (subscribers, [&myWebSocket] (std::weak_ptr<MyWebSocket<T> > const &subscriber) { return not subscriber.owner_before (myWebSocket) && not myWebSocket.owner_before (subscriber); });
+}
+
+template <class T>
+std::size_t
+Broadcaster<T>::broadcast (std::string message)
+{
+  return broadcast (std::make_shared<std::string const> (std::move (message)));
+}
+
+template <class T>
+std::size_t
+Broadcaster<T>::broadcast (SharedPayload message)
+{
+  auto queuedOn = std::size_t{};
+  std::erase_if (subscribers,
+                 [&message, &queuedOn] (std::weak_ptr<MyWebSocket<T> > const &subscriber)
+                   {
+                     if (auto myWebSocket = subscriber.lock ())
+                       {
+                         if (myWebSocket->queueMessage (message)) ++queuedOn;
+                         return false;
+                       }
+                     return true;
+                   });
+  return queuedOn;
+}
+
+template <class T>
+std::size_t
+Broadcaster<T>::subscriberCount () const
+{
+  return subscribers.size ();
+}
+
+template class Broadcaster<WebSocket>;
+template class Broadcaster<SSLWebSocket>;
+}
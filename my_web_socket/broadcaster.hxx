@@ -0,0 +1,27 @@
+#pragma once
+
+#include "my_web_socket/myWebSocket.hxx"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace my_web_socket
+{
+
+// queues one shared payload on every subscribed connection. not thread safe use it from the executor of the subscribed connections
+// only the payload is shared. every connection still builds its own frame header for it when its writeLoop writes the message
+template <class T = WebSocket> class Broadcaster
+{
+public:
+  void subscribe (std::shared_ptr<MyWebSocket<T> > const &myWebSocket);
+  void unsubscribe (std::shared_ptr<MyWebSocket<T> > const &myWebSocket);
+  std::size_t broadcast (std::string message); // returns the number of connections the message got queued on. permessage-deflate compresses the message once per connection
+  std::size_t broadcast (SharedPayload message);
+  std::size_t subscriberCount () const;
+
+private:
+  std::vector<std::weak_ptr<MyWebSocket<T> > > subscribers{};
+};
+
+}
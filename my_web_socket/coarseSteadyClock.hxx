@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+
+namespace my_web_socket
+{
+
+// steady clock which reads the time the kernel caches every scheduler tick instead of asking the hardware. resolution is a few milliseconds which is enough to timestamp messages for keepalive and idle detection. falls back to std::chrono::steady_clock where CLOCK_MONOTONIC_COARSE does not exist
+struct CoarseSteadyClock
+{
+  typedef std::chrono::nanoseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<CoarseSteadyClock> time_point;
+  static constexpr bool is_steady = true;
+
+  static time_point
+  now () noexcept
+  {
+#ifdef CLOCK_MONOTONIC_COARSE
+    auto timeSpec = timespec{};
+    clock_gettime (CLOCK_MONOTONIC_COARSE, &timeSpec);
+    return time_point{ std::chrono::seconds{ timeSpec.tv_sec } + std::chrono::nanoseconds{ timeSpec.tv_nsec } };
+#else
+    return time_point{ std::chrono::duration_cast<duration> (std::chrono::steady_clock::now ().time_since_epoch ()) };
+#endif
+  }
+};
+
+}
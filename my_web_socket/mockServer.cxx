@@ -38,7 +38,7 @@ template <class T>
 boost::asio::awaitable<void>
 MockServer<T>::serverShutDownTime ()
 {
-  auto timer = CoroTimer{ co_await boost::asio::this_coro::executor };
+  auto timer = SteadyCoroTimer{ co_await boost::asio::this_coro::executor };
   timer.expires_after (mockServerOption.mockServerRunTime.value ());
   try
     {
@@ -94,17 +94,19 @@ MockServer<T>::listener (boost::asio::ip::tcp::endpoint endpoint, std::string lo
               auto webSocket = T{ std::move (socket) };
               webSocket.set_option (websocket::stream_base::timeout::suggested (role_type::server));
               webSocket.set_option (websocket::stream_base::decorator ([] (websocket::response_type &res) { res.set (http::field::server, std::string (BOOST_BEAST_VERSION_STRING) + " webSocket-server-async"); }));
+              if (mockServerOption.permessageDeflate) webSocket.set_option (mockServerOption.permessageDeflate.value ());
               co_await webSocket.async_accept ();
-              webSockets.emplace_back (std::make_shared<MyWebSocket<WebSocket> > (std::move (webSocket), loggingName_, id_));
+              webSockets.emplace_back (std::make_shared<MyWebSocket<WebSocket> > (std::move (webSocket), loggingName_, id_, mockServerOption.myWebSocketOption));
             }
           else if constexpr (std::same_as<T, SSLWebSocket>)
             {
               auto webSocket = T{ std::move (socket), *sslContext };
               webSocket.set_option (websocket::stream_base::timeout::suggested (role_type::server));
               webSocket.set_option (websocket::stream_base::decorator ([] (websocket::response_type &res) { res.set (http::field::server, std::string (BOOST_BEAST_VERSION_STRING) + " websocket-server-async"); }));
+              if (mockServerOption.permessageDeflate) webSocket.set_option (mockServerOption.permessageDeflate.value ());
               co_await webSocket.next_layer ().async_handshake (ssl::stream_base::server, use_awaitable);
               co_await webSocket.async_accept (use_awaitable);
-              webSockets.emplace_back (std::make_shared<MyWebSocket<SSLWebSocket> > (std::move (webSocket), loggingName_, id_));
+              webSockets.emplace_back (std::make_shared<MyWebSocket<SSLWebSocket> > (std::move (webSocket), loggingName_, id_, mockServerOption.myWebSocketOption));
             }
           auto webSocketItr = std::prev (webSockets.end ());
           coSpawnTraced (executor,
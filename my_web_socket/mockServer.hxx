@@ -38,6 +38,8 @@ struct MockServerOption
   std::map<std::string, std::string> requestStartsWithResponse{};
   std::optional<std::chrono::microseconds> mockServerRunTime{};
   std::function<boost::beast::net::ssl::context ()> createSSLContext{};
+  std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate{}; // offered in the handshake of every accepted connection
+  MyWebSocketOption myWebSocketOption{};
 };
 template <class T = WebSocket> struct MockServer
 {
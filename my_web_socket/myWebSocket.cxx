@@ -1,16 +1,82 @@
 #include "my_web_socket/myWebSocket.hxx"
 #include "myWebSocket.hxx"
 #include "my_web_socket/coSpawnTraced.hxx"
+#include "my_web_socket/coarseSteadyClock.hxx"
+#include "my_web_socket/timerWheel.hxx"
 #include <boost/asio/awaitable.hpp>
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/experimental/channel.hpp>
 #include <boost/asio/redirect_error.hpp>
 #include <boost/asio/use_awaitable.hpp>
-#include <boost/beast/core/buffers_to_string.hpp>
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 
 namespace my_web_socket
 {
 
+namespace
+{
+// precise clock for round trip times
+std::chrono::nanoseconds::rep
+steadyClockNow ()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+// cheap clock for per message timestamps
+std::chrono::nanoseconds::rep
+coarseSteadyClockNow ()
+{
+  return CoarseSteadyClock::now ().time_since_epoch ().count ();
+}
+
+#ifdef TCP_CORK
+// socket option for TCP_CORK in the form asio's set_option expects. asio only ships TCP_NODELAY
+struct TcpCork
+{
+  int value{};
+
+  template <typename Protocol>
+  int
+  level (Protocol const &) const
+  {
+    return IPPROTO_TCP;
+  }
+  template <typename Protocol>
+  int
+  name (Protocol const &) const
+  {
+    return TCP_CORK;
+  }
+  template <typename Protocol>
+  int const *
+  data (Protocol const &) const
+  {
+    return &value;
+  }
+  template <typename Protocol>
+  std::size_t
+  size (Protocol const &) const
+  {
+    return sizeof (value);
+  }
+};
+#endif
+}
+
+boost::asio::awaitable<void>
+WriteCompletion::asyncWait ()
+{
+  co_await result.async_receive (boost::asio::use_awaitable);
+}
+
+void
+WriteCompletion::complete (boost::system::error_code ec)
+{
+  result.try_send (ec);
+}
+
 template <class T>
 std::string
 MyWebSocket<T>::rndNumberAsString ()
@@ -21,52 +87,298 @@ MyWebSocket<T>::rndNumberAsString ()
   return std::to_string (distr (eng));
 }
 
+template <class T>
+void
+MyWebSocket<T>::setUpWebSocket ()
+{
+  auto readMessageMax = myWebSocketOption.maxMessageSize;
+  if (myWebSocketOption.memoryBudget) readMessageMax = std::min (readMessageMax.value_or (webSocket.read_message_max ()), myWebSocketOption.memoryBudget.value ()); // beast closes with 1009 before the read buffer grows past the budget
+  if (readMessageMax) webSocket.read_message_max (readMessageMax.value ());
+  if (myWebSocketOption.maxOutboundFrameSize)
+    {
+      webSocket.auto_fragment (true);
+      webSocket.write_buffer_bytes (myWebSocketOption.maxOutboundFrameSize.value ()); // beast takes it over at the start of every message
+    }
+  if (myWebSocketOption.memoryBudget) readBuffer.max_size (myWebSocketOption.memoryBudget.value ()); // flat_buffer grows to at least twice what it holds. the limit keeps a message that fits the budget from growing the buffer past it
+  lastReadAt.store (coarseSteadyClockNow (), std::memory_order_relaxed);
+  webSocket.control_callback (
+      [this] (boost::beast::websocket::frame_type kind, boost::beast::string_view payload)
+        {
+          if (kind == boost::beast::websocket::frame_type::pong) onPong ({ payload.data (), payload.size () });
+        });
+}
+
+template <class T> MyWebSocket<T>::~MyWebSocket ()
+{
+  inbox.consume_all ([] (QueuedMessage *message) { delete message; });
+}
+
+template <class T>
+void
+MyWebSocket<T>::resetReadBuffer ()
+{
+  readBuffer.consume (readBuffer.size ());
+  if (myWebSocketOption.shrinkReadBufferAbove && readBuffer.capacity () > myWebSocketOption.shrinkReadBufferAbove.value ()) readBuffer.shrink_to_fit ();
+  readBufferSize.store (0, std::memory_order_relaxed);
+}
+
+template <class T>
+std::string_view
+MyWebSocket<T>::readBufferView () const
+{
+  return { static_cast<char const *> (readBuffer.data ().data ()), readBuffer.size () };
+}
+
+template <class T>
+bool
+MyWebSocket<T>::isOverMemoryBudget (std::size_t additionalBytes) const
+{
+  return myWebSocketOption.memoryBudget && readBufferSize.load (std::memory_order_relaxed) + queuedBytes.load (std::memory_order_relaxed) + additionalBytes > myWebSocketOption.memoryBudget.value ();
+}
+
+template <class T>
+boost::asio::awaitable<void>
+MyWebSocket<T>::asyncReadIntoReadBuffer ()
+{
+  resetReadBuffer ();
+  if (not myWebSocketOption.hibernateAfter || not co_await asyncReadFirstByteIntoReadBuffer ()) co_await webSocket.async_read (readBuffer, boost::asio::use_awaitable); // async_read continues the message the first byte belongs to
+  lastReadAt.store (coarseSteadyClockNow (), std::memory_order_relaxed);
+#ifdef MY_WEB_SOCKET_LOG_READ
+  spdlog::info ("[{}{}] [r] '{}'", loggingName, id, readBufferView ());
+#endif
+  readBufferSize.store (readBuffer.size (), std::memory_order_relaxed);
+  if (isOverMemoryBudget ())
+    {
+      co_await asyncClose (boost::beast::websocket::close_code::too_big);
+      throw boost::system::system_error{ boost::beast::websocket::error::message_too_big };
+    }
+}
+
+template <class T>
+boost::asio::awaitable<bool>
+MyWebSocket<T>::asyncReadFirstByteIntoReadBuffer ()
+{
+  if (not scheduledHibernationCheck) scheduleHibernationCheck (myWebSocketOption.hibernateAfter.value ());
+  auto firstByte = std::array<char, 1>{};
+  waitingForMessage = true; // nothing holds on to readBuffer while we wait here so hibernateIfIdle can release it
+  auto const bytesRead = co_await webSocket.async_read_some (boost::asio::buffer (firstByte), boost::asio::use_awaitable);
+  waitingForMessage = false;
+  hibernating.store (false, std::memory_order_relaxed);
+  readBuffer.commit (boost::asio::buffer_copy (readBuffer.prepare (bytesRead), boost::asio::buffer (firstByte.data (), bytesRead)));
+  co_return webSocket.is_message_done ();
+}
+
+template <class T>
+void
+MyWebSocket<T>::scheduleHibernationCheck (std::chrono::steady_clock::duration delay)
+{
+  scheduledHibernationCheck = scheduleOnTimerWheel (delay, &MyWebSocket::hibernateIfIdle);
+}
+
+template <class T>
+void
+MyWebSocket<T>::hibernateIfIdle ()
+{
+  scheduledHibernationCheck.reset (); // the next wait for a message schedules the check again
+  auto const idleFor = std::chrono::nanoseconds{ coarseSteadyClockNow () - lastReadAt.load (std::memory_order_relaxed) };
+  if (running.load (std::memory_order_acquire) && waitingForMessage && idleFor < myWebSocketOption.hibernateAfter.value ())
+    {
+      scheduleHibernationCheck (std::chrono::duration_cast<std::chrono::steady_clock::duration> (myWebSocketOption.hibernateAfter.value () - idleFor));
+      return;
+    }
+  if (not running.load (std::memory_order_acquire) || not waitingForMessage) return;
+  hibernating.store (true, std::memory_order_relaxed);
+  readBuffer.shrink_to_fit ();
+  {
+    auto lock = std::scoped_lock{ sendBufferPoolMutex };
+    sendBufferPool = {};
+  }
+  for (auto &messages : msgQueue)
+    if (messages.empty ()) messages.shrink_to_fit ();
+  if (conflatedMessages.empty ()) conflatedMessages = {};
+}
+
+template <class T>
+bool
+MyWebSocket<T>::isHibernating () const
+{
+  return hibernating.load (std::memory_order_relaxed);
+}
+
 template <class T>
 boost::asio::awaitable<std::string>
 MyWebSocket<T>::asyncReadOneMessage ()
 {
-  [[maybe_unused]] auto self = this->shared_from_this ();
-  boost::beast::flat_buffer buffer;
-  co_await webSocket.async_read (buffer, boost::asio::use_awaitable);
-  auto msg = boost::beast::buffers_to_string (buffer.data ());
+  co_await asyncReadIntoReadBuffer ();
+  auto message = std::string{ readBufferView () };
+  resetReadBuffer (); // the copy is all the caller keeps so the read buffer does not count against memoryBudget until the next read
+  co_return message;
+}
+
+template <class T>
+boost::beast::websocket::close_reason const &
+MyWebSocket<T>::closeReason () const
+{
+  return webSocket.reason ();
+}
+
+template <class T>
+void
+MyWebSocket<T>::onReadLoopEnd ()
+{
+  cancelTimers ();
+  writeSignal.close ();
+  inboundMessages.close ();
+  failQueuedMessages ();
 #ifdef MY_WEB_SOCKET_LOG_READ
-  spdlog::info ("[{}{}] [r] '{}'", loggingName, id, msg);
+  spdlog::info ("[{}{}] [c]", loggingName, id);
 #endif
-  co_return msg;
 }
 
 template <class T>
 inline boost::asio::awaitable<void>
 MyWebSocket<T>::readLoop (std::function<void (std::string readResult)> onRead)
+{
+  co_await readLoop<std::function<void (std::string readResult)> > (std::move (onRead));
+}
+
+template <class T>
+boost::asio::awaitable<void>
+MyWebSocket<T>::readLoopView (std::function<void (std::string_view readResult)> onRead)
+{
+  [[maybe_unused]] auto self = this->shared_from_this ();
+  try
+    {
+      for (;;)
+        {
+          co_await asyncReadIntoReadBuffer ();
+          onRead (readBufferView ());
+        }
+    }
+  catch (...)
+    {
+      onReadLoopEnd ();
+      throw;
+    }
+}
+template <class T>
+boost::asio::awaitable<void>
+MyWebSocket<T>::readLoopWithOpcode (std::function<void (Opcode opcode, std::span<std::byte const> readResult)> onRead)
 {
   [[maybe_unused]] auto self = this->shared_from_this ();
   try
     {
       for (;;)
         {
-          auto oneMsg = co_await asyncReadOneMessage ();
-          onRead (std::move (oneMsg));
+          co_await asyncReadIntoReadBuffer ();
+          onRead (webSocket.got_binary () ? Opcode::binary : Opcode::text, std::as_bytes (std::span{ readBufferView () }));
         }
     }
   catch (...)
     {
-      pingTimer.cancel ();
-      writeSignal.close ();
+      onReadLoopEnd ();
+      throw;
+    }
+}
+
+template <class T>
+boost::asio::awaitable<void>
+MyWebSocket<T>::readLoopFragments (std::function<void (std::string_view fragment, bool isMessageDone)> onRead, std::size_t maxFragmentSize)
+{
+  [[maybe_unused]] auto self = this->shared_from_this ();
+  try
+    {
+      for (;;)
+        {
+          resetReadBuffer ();
+          co_await webSocket.async_read_some (readBuffer, maxFragmentSize, boost::asio::use_awaitable);
+          lastReadAt.store (coarseSteadyClockNow (), std::memory_order_relaxed);
 #ifdef MY_WEB_SOCKET_LOG_READ
-      spdlog::info ("[{}{}] [c]", loggingName, id);
+          spdlog::info ("[{}{}] [r] fragment '{}'", loggingName, id, readBufferView ());
 #endif
+          readBufferSize.store (readBuffer.size (), std::memory_order_relaxed);
+          if (isOverMemoryBudget ())
+            {
+              co_await asyncClose (boost::beast::websocket::close_code::too_big);
+              throw boost::system::system_error{ boost::beast::websocket::error::message_too_big };
+            }
+          onRead (readBufferView (), webSocket.is_message_done ());
+        }
+    }
+  catch (...)
+    {
+      onReadLoopEnd ();
+      throw;
+    }
+}
+
+template <class T>
+boost::asio::awaitable<void>
+MyWebSocket<T>::readLoopIntoChannel ()
+{
+  [[maybe_unused]] auto self = this->shared_from_this ();
+  try
+    {
+      for (;;)
+        {
+          co_await asyncReadIntoReadBuffer ();
+          co_await inboundMessages.async_send (boost::system::error_code{}, std::string{ readBufferView () }, boost::asio::use_awaitable);
+        }
+    }
+  catch (...)
+    {
+      onReadLoopEnd ();
       throw;
     }
 }
+
+template <class T>
+boost::asio::awaitable<std::string>
+MyWebSocket<T>::nextMessage ()
+{
+  co_return co_await inboundMessages.async_receive (boost::asio::use_awaitable);
+}
+
+template <class T>
+boost::asio::awaitable<void>
+MyWebSocket<T>::asyncWrite (std::string_view message, Opcode opcode)
+{
+#ifdef MY_WEB_SOCKET_LOG_WRITE
+  if (opcode == Opcode::binary)
+    spdlog::info ("[{}{}] [w] binary {} bytes", loggingName, id, message.size ());
+  else
+    spdlog::info ("[{}{}] [w] '{}'", loggingName, id, message);
+#endif
+  webSocket.binary (opcode == Opcode::binary);
+  webSocket.compress (message.size () >= myWebSocketOption.minCompressedMessageSize);
+  co_await webSocket.async_write (boost::asio::buffer (message), boost::asio::use_awaitable);
+}
+
 template <class T>
 inline boost::asio::awaitable<void>
 MyWebSocket<T>::asyncWriteOneMessage (std::string message)
 {
-  [[maybe_unused]] auto self = this->shared_from_this ();
-#ifdef MY_WEB_SOCKET_LOG_WRITE
-  spdlog::info ("[{}{}] [w] '{}'", loggingName, id, message);
+  co_await asyncWrite (message, Opcode::text);
+}
+
+template <class T>
+boost::asio::awaitable<void>
+MyWebSocket<T>::asyncWriteOneBinaryMessage (std::span<std::byte const> message)
+{
+  co_await asyncWrite ({ reinterpret_cast<char const *> (message.data ()), message.size () }, Opcode::binary);
+}
+
+template <class T>
+bool
+MyWebSocket<T>::cork (bool enable)
+{
+#ifdef TCP_CORK
+  auto ec = boost::system::error_code{};
+  boost::beast::get_lowest_layer (webSocket).socket ().set_option (TcpCork{ enable ? 1 : 0 }, ec);
+  return not ec;
+#else
+  return false;
 #endif
-  co_await webSocket.async_write (boost::asio::buffer (std::move (message)), boost::asio::use_awaitable);
 }
 
 template <class T>
@@ -74,40 +386,311 @@ boost::asio::awaitable<void>
 MyWebSocket<T>::writeLoop ()
 {
   [[maybe_unused]] auto self = this->shared_from_this ();
-  while (running.load (std::memory_order_acquire))
+  try
     {
-      co_await writeSignal.async_receive (boost::asio::use_awaitable);
-      while (running && !msgQueue.empty ())
+      while (running.load (std::memory_order_acquire))
         {
-          auto msg = std::move (msgQueue.front ());
-          msgQueue.pop_front ();
-          co_await asyncWriteOneMessage (std::move (msg));
+          co_await writeSignal.async_receive (boost::asio::use_awaitable);
+          drainInbox ();
+          auto const corked = myWebSocketOption.flushMode == FlushMode::batched && msgQueueSize () > 1 && cork (true);
+          while (running && msgQueueSize () != 0)
+            {
+              auto lane = std::size_t{}; // lanes are ordered from high to low priority
+              while (msgQueue[lane].empty ())
+                ++lane;
+              auto msg = popFrontOfMsgQueue (lane);
+              co_await asyncWrite (msg.view (), msg.opcode);
+              msg.writeCompletionHandle.complete ({});
+              recycleSendBuffer (std::move (msg));
+            }
+          if (corked) cork (false); // uncorking sends what is left
         }
     }
-  pingTimer.cancel ();
+  catch (...)
+    {
+      onWriteLoopEnd ();
+      throw;
+    }
+  onWriteLoopEnd ();
+}
+
+template <class T>
+void
+MyWebSocket<T>::onWriteLoopEnd ()
+{
+  cancelTimers ();
   writeSignal.close ();
+  failQueuedMessages ();
+}
+
+template <class T>
+bool
+MyWebSocket<T>::isQueueFull (std::size_t additionalMessages, std::size_t additionalBytes) const
+{
+  return (myWebSocketOption.maxQueuedMessages && queuedMessages.load (std::memory_order_relaxed) + additionalMessages > myWebSocketOption.maxQueuedMessages.value ()) || (myWebSocketOption.maxQueuedBytes && queuedBytes.load (std::memory_order_relaxed) + additionalBytes > myWebSocketOption.maxQueuedBytes.value ());
 }
 
 template <class T>
-inline void
-MyWebSocket<T>::queueMessage (std::string message)
+bool
+MyWebSocket<T>::enqueue (QueuedMessage message)
 {
-  msgQueue.push_back (std::move (message));
+  if (not running.load (std::memory_order_acquire)) return false;
+  auto const messageSize = message.view ().size ();
+  if (isOverMemoryBudget (messageSize))
+    {
+      coSpawnTraced (webSocket.get_executor (), asyncClose (boost::beast::websocket::close_code::too_big), "MyWebSocket memoryBudget asyncClose");
+      return false;
+    }
+  if (isQueueFull (1, messageSize))
+    {
+      switch (myWebSocketOption.slowConsumerPolicy)
+        {
+        case SlowConsumerPolicy::dropOldest:
+          break; // drainInbox drops the oldest messages. only the executor is allowed to touch msgQueue
+        case SlowConsumerPolicy::dropNewest:
+          droppedMessages.fetch_add (1, std::memory_order_relaxed);
+          return true;
+        case SlowConsumerPolicy::reject:
+          return false;
+        case SlowConsumerPolicy::close:
+          coSpawnTraced (webSocket.get_executor (), asyncClose (boost::beast::websocket::close_code::policy_error), "MyWebSocket slowConsumerPolicy asyncClose");
+          return false;
+        }
+    }
+  auto queuedMessage = std::make_unique<QueuedMessage> (std::move (message));
+  queuedMessages.fetch_add (1, std::memory_order_relaxed); // counted before the push so the executor never subtracts a message it was not added for
+  queuedBytes.fetch_add (messageSize, std::memory_order_relaxed);
+  if (not inbox.push (queuedMessage.get ()))
+    {
+      queuedMessages.fetch_sub (1, std::memory_order_relaxed);
+      queuedBytes.fetch_sub (messageSize, std::memory_order_relaxed);
+      return false;
+    }
+  queuedMessage.release ();
+  if (wakeUpPending.exchange (true, std::memory_order_acq_rel)) return true; // the pending wake up drains this message too
+  auto const executor = webSocket.get_executor ();
+  if (auto const ioContextExecutor = executor.template target<boost::asio::io_context::executor_type> (); ioContextExecutor && ioContextExecutor->running_in_this_thread ())
+    wakeUpWriteLoop (); // the caller keeps the web socket alive while we are on its thread so no reference count is needed
+  else
+    boost::asio::dispatch (executor, [self = this->shared_from_this ()] () { self->wakeUpWriteLoop (); }); // keeps the web socket alive until the wake up ran on its executor
+  return true;
+}
+
+template <class T>
+void
+MyWebSocket<T>::wakeUpWriteLoop ()
+{
+  wakeUpPending.exchange (false, std::memory_order_acq_rel); // before draining so a message pushed while we drain wakes us up again. a plain store could become visible after the pops of drainInbox and strand a message nobody wakes us up for
+  if (not running.load (std::memory_order_acquire) || not writeSignal.is_open ())
+    {
+      failQueuedMessages (); // the message got pushed after close. nothing would write it
+      return;
+    }
+  drainInbox ();
   writeSignal.try_send (boost::system::error_code{});
 }
 
+template <class T>
+void
+MyWebSocket<T>::drainInbox ()
+{
+  inbox.consume_all (
+      [this] (QueuedMessage *message)
+        {
+          if (message->conflationKey)
+            {
+              if (auto conflatedMessage = conflatedMessages.find (message->conflationKey.value ()); conflatedMessage != conflatedMessages.end ())
+                {
+                  queuedMessages.fetch_sub (1, std::memory_order_relaxed);
+                  queuedBytes.fetch_sub (conflatedMessage->second->view ().size (), std::memory_order_relaxed);
+                  conflatedMessage->second->payload = std::move (message->payload); // keeps its place in the queue
+                  conflatedMessage->second->opcode = message->opcode;
+                  conflatedMessage->second->fromSendBufferPool = message->fromSendBufferPool;
+                  conflatedMessage->second->writeCompletionHandle = std::move (message->writeCompletionHandle); // the replaced message will not be written
+                  delete message;
+                  return;
+                }
+            }
+          auto &lane = msgQueue[static_cast<std::size_t> (message->priority)];
+          lane.push_back (std::move (*message));
+          delete message;
+          if (lane.back ().conflationKey) conflatedMessages.emplace (lane.back ().conflationKey.value (), &lane.back ());
+          if (myWebSocketOption.slowConsumerPolicy == SlowConsumerPolicy::dropOldest)
+            {
+              while (msgQueueSize () > 1 && isQueueFull (0, 0))
+                {
+                  auto dropLane = msgQueue.size () - 1; // drop from the lowest priority first
+                  while (msgQueue[dropLane].empty ())
+                    --dropLane;
+                  popFrontOfMsgQueue (dropLane);
+                  droppedMessages.fetch_add (1, std::memory_order_relaxed);
+                }
+            }
+        });
+}
+
+template <class T>
+void
+MyWebSocket<T>::failQueuedMessages ()
+{
+  auto forget = [this] (QueuedMessage const &message)
+    {
+      queuedMessages.fetch_sub (1, std::memory_order_relaxed);
+      queuedBytes.fetch_sub (message.view ().size (), std::memory_order_relaxed);
+    };
+  inbox.consume_all (
+      [&forget] (QueuedMessage *message)
+        {
+          forget (*message);
+          delete message; // destroying a message fails its write completion
+        });
+  for (auto &lane : msgQueue)
+    {
+      for (auto const &message : lane)
+        forget (message);
+      lane.clear ();
+    }
+  conflatedMessages.clear ();
+}
+
+template <class T>
+std::size_t
+MyWebSocket<T>::msgQueueSize () const
+{
+  auto size = std::size_t{};
+  for (auto const &messages : msgQueue)
+    size += messages.size ();
+  return size;
+}
+
+template <class T>
+typename MyWebSocket<T>::QueuedMessage
+MyWebSocket<T>::popFrontOfMsgQueue (std::size_t lane)
+{
+  auto message = std::move (msgQueue[lane].front ());
+  msgQueue[lane].pop_front ();
+  if (message.conflationKey) conflatedMessages.erase (message.conflationKey.value ());
+  queuedMessages.fetch_sub (1, std::memory_order_relaxed);
+  queuedBytes.fetch_sub (message.view ().size (), std::memory_order_relaxed);
+  return message;
+}
+
+template <class T>
+inline bool
+MyWebSocket<T>::queueMessage (std::string message, Priority priority)
+{
+  return enqueue ({ .payload = std::move (message), .opcode = Opcode::text, .priority = priority });
+}
+
+template <class T>
+bool
+MyWebSocket<T>::queueMessage (SharedPayload message, Priority priority)
+{
+  return enqueue ({ .payload = std::move (message), .opcode = Opcode::text, .priority = priority });
+}
+
+template <class T>
+bool
+MyWebSocket<T>::queueBinary (std::span<std::byte const> message, Priority priority)
+{
+  return enqueue ({ .payload = std::string{ reinterpret_cast<char const *> (message.data ()), message.size () }, .opcode = Opcode::binary, .priority = priority });
+}
+
+template <class T>
+std::string
+MyWebSocket<T>::takeSendBuffer (std::size_t sizeHint)
+{
+  auto sendBuffer = std::string{};
+  {
+    auto lock = std::scoped_lock{ sendBufferPoolMutex };
+    if (not sendBufferPool.empty ())
+      {
+        sendBuffer = std::move (sendBufferPool.back ());
+        sendBufferPool.pop_back ();
+      }
+  }
+  sendBuffer.reserve (sizeHint);
+  return sendBuffer;
+}
+
+template <class T>
+void
+MyWebSocket<T>::recycleSendBuffer (QueuedMessage message)
+{
+  auto *sendBuffer = std::get_if<std::string> (&message.payload);
+  if (not message.fromSendBufferPool || not sendBuffer || sendBuffer->capacity () > myWebSocketOption.maxPooledSendBufferCapacity) return;
+  sendBuffer->clear ();
+  auto lock = std::scoped_lock{ sendBufferPoolMutex };
+  if (sendBufferPool.size () < myWebSocketOption.sendBufferPoolSize) sendBufferPool.push_back (std::move (*sendBuffer));
+}
+
+template <class T>
+bool
+MyWebSocket<T>::queueMessage (std::string key, std::string message, Priority priority)
+{
+  return enqueue ({ .payload = std::move (message), .opcode = Opcode::text, .priority = priority, .conflationKey = std::move (key) });
+}
+
+template <class T>
+bool
+MyWebSocket<T>::queueMessage (std::string key, SharedPayload message, Priority priority)
+{
+  return enqueue ({ .payload = std::move (message), .opcode = Opcode::text, .priority = priority, .conflationKey = std::move (key) });
+}
+
+template <class T>
+std::shared_ptr<WriteCompletion>
+MyWebSocket<T>::queueTrackedMessage (std::string message, Priority priority)
+{
+  auto writeCompletion = std::make_shared<WriteCompletion> (webSocket.get_executor ());
+  enqueue ({ .payload = std::move (message), .opcode = Opcode::text, .priority = priority, .writeCompletionHandle = WriteCompletionHandle{ writeCompletion } });
+  return writeCompletion;
+}
+
+template <class T>
+std::shared_ptr<WriteCompletion>
+MyWebSocket<T>::queueTrackedMessage (SharedPayload message, Priority priority)
+{
+  auto writeCompletion = std::make_shared<WriteCompletion> (webSocket.get_executor ());
+  enqueue ({ .payload = std::move (message), .opcode = Opcode::text, .priority = priority, .writeCompletionHandle = WriteCompletionHandle{ writeCompletion } });
+  return writeCompletion;
+}
+
+template <class T>
+std::size_t
+MyWebSocket<T>::queueDepth () const
+{
+  return queuedMessages.load (std::memory_order_relaxed);
+}
+
+template <class T>
+std::size_t
+MyWebSocket<T>::queuedByteCount () const
+{
+  return queuedBytes.load (std::memory_order_relaxed);
+}
+
+template <class T>
+std::size_t
+MyWebSocket<T>::droppedMessageCount () const
+{
+  return droppedMessages.load (std::memory_order_relaxed);
+}
+
 template <class T>
 boost::asio::awaitable<void>
-MyWebSocket<T>::asyncClose ()
+MyWebSocket<T>::asyncClose (boost::beast::websocket::close_reason closeReason)
 {
   [[maybe_unused]] auto self = this->shared_from_this ();
   if (not running.load (std::memory_order_acquire)) co_return;
   running.store (false, std::memory_order_release);
   webSocket.set_option (boost::beast::websocket::stream_base::timeout{ .handshake_timeout = std::chrono::milliseconds{ 1 } }); // do not wait longer than 1 millisecond for handshake close
   auto ec = boost::system::error_code{};
-  co_await webSocket.async_close (boost::beast::websocket::close_code::normal, boost::asio::redirect_error (boost::asio::use_awaitable, ec));
-  pingTimer.cancel ();
+  co_await webSocket.async_close (closeReason, boost::asio::redirect_error (boost::asio::use_awaitable, ec));
+  cancelTimers ();
   writeSignal.close ();
+  inboundMessages.cancel (); // readLoopIntoChannel could wait for space in the channel which nobody makes anymore
+  failQueuedMessages ();
 }
 
 template <class T>
@@ -115,15 +698,143 @@ boost::asio::awaitable<void>
 MyWebSocket<T>::sendPingToEndpoint ()
 {
   [[maybe_unused]] auto self = this->shared_from_this ();
+  auto wait = myWebSocketOption.pingInterval;
   while (running.load (std::memory_order_acquire))
     {
-      pingTimer.expires_after (std::chrono::seconds{ 10 });
+      pingTimer.expires_after (wait);
       co_await pingTimer.async_wait ();
-      co_await webSocket.async_ping ({}, boost::asio::use_awaitable);
+      wait = timeUntilNextPing ();
+      if (wait != std::chrono::steady_clock::duration{}) continue;
+      co_await webSocket.async_ping (startPing (), boost::asio::use_awaitable);
+      wait = myWebSocketOption.pingInterval;
     }
   co_return;
 }
 
+template <class T>
+void
+MyWebSocket<T>::pingEndpointPeriodically ()
+{
+  schedulePing (myWebSocketOption.pingInterval);
+}
+
+template <class T>
+std::optional<TimerWheel::EntryId>
+MyWebSocket<T>::scheduleOnTimerWheel (std::chrono::steady_clock::duration delay, void (MyWebSocket::*onExpiry) ())
+{
+  if (not running.load (std::memory_order_acquire) || not writeSignal.is_open ()) return std::nullopt; // cancelTimers already ran
+  return TimerWheel::of (webSocket.get_executor ())
+      .schedule (delay,
+                 [weakSelf = this->weak_from_this (), onExpiry] ()
+                   {
+                     if (auto self = weakSelf.lock ()) boost::asio::dispatch (self->webSocket.get_executor (), [self, onExpiry] () { ((*self).*onExpiry) (); });
+                   });
+}
+
+template <class T>
+void
+MyWebSocket<T>::cancelTimers ()
+{
+  pingTimer.cancel ();
+  for (auto *scheduled : { &scheduledPing, &scheduledPongCheck, &scheduledHibernationCheck })
+    {
+      if (*scheduled) TimerWheel::of (webSocket.get_executor ()).cancel (scheduled->value ());
+      scheduled->reset ();
+    }
+}
+
+template <class T>
+void
+MyWebSocket<T>::schedulePing (std::chrono::steady_clock::duration delay)
+{
+  if (not scheduledPing) scheduledPing = scheduleOnTimerWheel (delay, &MyWebSocket::sendScheduledPing);
+}
+
+template <class T>
+void
+MyWebSocket<T>::sendScheduledPing ()
+{
+  scheduledPing.reset ();
+  if (not running.load (std::memory_order_acquire)) return;
+  if (auto const wait = timeUntilNextPing (); wait != std::chrono::steady_clock::duration{})
+    {
+      schedulePing (wait);
+      return;
+    }
+  webSocket.async_ping (startPing (),
+                        [weakSelf = this->weak_from_this ()] (boost::system::error_code ec)
+                          {
+                            if (ec) return;
+                            if (auto self = weakSelf.lock ()) self->pingEndpointPeriodically ();
+                          });
+}
+
+template <class T>
+std::chrono::steady_clock::duration
+MyWebSocket<T>::timeUntilNextPing () const
+{
+  if (myWebSocketOption.keepaliveMode == KeepaliveMode::fixedInterval) return {};
+  auto const idleFor = std::chrono::nanoseconds{ coarseSteadyClockNow () - lastReadAt.load (std::memory_order_relaxed) };
+  return std::max (std::chrono::steady_clock::duration{}, std::chrono::duration_cast<std::chrono::steady_clock::duration> (myWebSocketOption.pingInterval - idleFor));
+}
+
+template <class T>
+boost::beast::websocket::ping_data
+MyWebSocket<T>::startPing ()
+{
+  auto const sentAt = steadyClockNow ();
+  auto noUnansweredPing = std::chrono::nanoseconds::rep{};
+  unansweredPingSentAt.compare_exchange_strong (noUnansweredPing, sentAt, std::memory_order_relaxed); // keeps the oldest unanswered ping
+  if (myWebSocketOption.pongTimeout && not scheduledPongCheck) scheduledPongCheck = scheduleOnTimerWheel (myWebSocketOption.pongTimeout.value (), &MyWebSocket::checkPong); // one pending check covers every ping because it looks at the oldest unanswered one
+  auto payload = std::array<char, 20>{};
+  auto const [payloadEnd, ec] = std::to_chars (payload.data (), payload.data () + payload.size (), sentAt);
+  return boost::beast::websocket::ping_data (payload.data (), static_cast<std::size_t> (payloadEnd - payload.data ()));
+}
+
+template <class T>
+void
+MyWebSocket<T>::checkPong ()
+{
+  scheduledPongCheck.reset ();
+  auto const unansweredSince = unansweredPingSentAt.load (std::memory_order_relaxed);
+  if (unansweredSince == 0) return; // the next ping schedules the check again
+  if (auto const unansweredFor = std::chrono::nanoseconds{ steadyClockNow () - unansweredSince }; unansweredFor < myWebSocketOption.pongTimeout.value ())
+    {
+      scheduledPongCheck = scheduleOnTimerWheel (std::chrono::duration_cast<std::chrono::steady_clock::duration> (myWebSocketOption.pongTimeout.value () - unansweredFor), &MyWebSocket::checkPong);
+      return;
+    }
+  coSpawnTraced (webSocket.get_executor (), asyncClose (boost::beast::websocket::close_code::going_away), "MyWebSocket pongTimeout asyncClose");
+}
+
+template <class T>
+void
+MyWebSocket<T>::onPong (std::string_view payload)
+{
+  unansweredPingSentAt.store (0, std::memory_order_relaxed); // any pong shows the peer is alive
+  auto sentAt = std::chrono::nanoseconds::rep{};
+  if (auto const [payloadEnd, ec] = std::from_chars (payload.data (), payload.data () + payload.size (), sentAt); ec != std::errc{} || payloadEnd != payload.data () + payload.size ()) return; // unsolicited pong or a ping someone else sent
+  auto const roundTripTime = std::max (std::chrono::nanoseconds::rep{ 1 }, steadyClockNow () - sentAt);
+  latestRoundTripTime.store (roundTripTime, std::memory_order_relaxed);
+  auto const smoothed = smoothedRoundTripTimeValue.load (std::memory_order_relaxed);
+  smoothedRoundTripTimeValue.store (smoothed == 0 ? roundTripTime : smoothed + (roundTripTime - smoothed) / 8, std::memory_order_relaxed);
+}
+
+template <class T>
+std::optional<std::chrono::nanoseconds>
+MyWebSocket<T>::roundTripTime () const
+{
+  if (auto const value = latestRoundTripTime.load (std::memory_order_relaxed); value != 0) return std::chrono::nanoseconds{ value };
+  return std::nullopt;
+}
+
+template <class T>
+std::optional<std::chrono::nanoseconds>
+MyWebSocket<T>::smoothedRoundTripTime () const
+{
+  if (auto const value = smoothedRoundTripTimeValue.load (std::memory_order_relaxed); value != 0) return std::chrono::nanoseconds{ value };
+  return std::nullopt;
+}
+
 template class MyWebSocket<WebSocket>;
 template class MyWebSocket<SSLWebSocket>;
 }
\ No newline at end of file
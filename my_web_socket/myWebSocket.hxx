@@ -1,43 +1,284 @@
 #pragma once
 
+#include "my_web_socket/timerWheel.hxx"
 #include <boost/asio/experimental/channel.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <boost/beast/core/tcp_stream.hpp>
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/websocket.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
 #include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace my_web_socket
 {
 
 typedef boost::beast::websocket::stream<boost::asio::use_awaitable_t<>::as_default_on_t<boost::beast::tcp_stream> > WebSocket;
 typedef boost::beast::websocket::stream<boost::beast::ssl_stream<boost::beast::tcp_stream> > SSLWebSocket;
-typedef boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::basic_waitable_timer<boost::asio::chrono::system_clock> > CoroTimer;
+typedef boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::basic_waitable_timer<boost::asio::chrono::system_clock> > CoroTimer; // follows wall clock jumps. prefer SteadyCoroTimer for timeouts
+typedef boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::basic_waitable_timer<std::chrono::steady_clock> > SteadyCoroTimer;
+
+typedef std::shared_ptr<std::string const> SharedPayload;
+
+enum class Opcode
+{
+  text,
+  binary
+};
+
+enum class Priority
+{
+  high, // writeLoop writes all queued high priority messages before the next normal one
+  normal
+};
+
+enum class FlushMode
+{
+  perMessage,
+  batched // writeLoop corks the tcp socket while it writes all queued messages so they leave in full segments instead of one segment per message. every message is still its own write call and with ssl its own record. only has an effect where TCP_CORK exists
+};
+
+enum class SlowConsumerPolicy
+{
+  dropOldest, // queued messages get dropped until the new one fits
+  dropNewest, // new message gets dropped silently
+  reject,     // new message gets dropped and queueMessage returns false
+  close       // connection gets closed with close code 1008 (policy error) and queueMessage returns false
+};
+
+enum class KeepaliveMode
+{
+  fixedInterval, // ping every pingInterval
+  whenIdle       // ping only after nothing got read for pingInterval. busy connections are obviously alive
+};
+
+struct MyWebSocketOption
+{
+  std::optional<std::size_t> shrinkReadBufferAbove{ 64 * 1024 }; // read buffer gets reused between messages. if its capacity grows above this it gets released before the next read. std::nullopt keeps it forever
+  std::size_t inboundMessageChannelSize{ 64 }; // messages readLoopIntoChannel buffers before it stops reading from the socket
+  std::optional<std::size_t> maxMessageSize{}; // a bigger inbound message closes the connection with close code 1009 (too big). std::nullopt keeps beast's default
+  std::optional<std::size_t> memoryBudget{}; // upper limit for the inbound message being read plus queued outbound bytes. going over it closes the connection with close code 1009 (too big). inbound messages bigger than the budget get rejected while they are read
+  FlushMode flushMode{ FlushMode::perMessage };
+  std::optional<std::size_t> maxQueuedMessages{}; // write queue limits. slowConsumerPolicy decides what happens if a new message does not fit. limits are checked without a lock so concurrent producers can overshoot them by one message each
+  std::optional<std::size_t> maxQueuedBytes{};
+  SlowConsumerPolicy slowConsumerPolicy{ SlowConsumerPolicy::reject };
+  std::size_t minCompressedMessageSize{}; // smaller outbound messages are sent uncompressed even if permessage-deflate got negotiated. permessage-deflate itself gets negotiated in the handshake so it has to be set on the stream before MyWebSocket takes it over
+  std::optional<std::size_t> maxOutboundFrameSize{}; // bigger outbound messages get written as continuation frames of this size using beast's auto_fragment with write_buffer_bytes. beast gives up the write lock between the frames so ping, pong and close frames do not wait until a big message is done. has to be at least 8
+  std::chrono::steady_clock::duration pingInterval{ std::chrono::seconds{ 10 } }; // used by sendPingToEndpoint and pingEndpointPeriodically
+  KeepaliveMode keepaliveMode{ KeepaliveMode::fixedInterval };
+  std::optional<std::chrono::steady_clock::duration> pongTimeout{}; // closes the connection with close code 1001 (going away) if no pong arrives this long after a ping. pongs only get noticed while a read loop runs
+  std::optional<std::chrono::steady_clock::duration> hibernateAfter{}; // a connection waiting for a message this long releases its read buffer, pooled send buffers and empty queue storage. needs a read loop other than readLoopFragments. every message then gets read in two steps so the read buffer is only held while a message arrives
+  std::size_t sendBufferPoolSize{ 16 }; // messages queued with queueMessageWith give their buffer back to a pool the next queueMessageWith serializes into
+  std::size_t maxPooledSendBufferCapacity{ 64 * 1024 }; // send buffers with more capacity get released instead of pooled
+};
+
+// resolves when writeLoop wrote the message. fails with operation_aborted if the message gets dropped or the connection closes before. await it once
+class WriteCompletion
+{
+public:
+  explicit WriteCompletion (boost::asio::any_io_executor executor) : result{ std::move (executor), 1 } {}
+  boost::asio::awaitable<void> asyncWait (); // throws boost::system::system_error if the message was not written
+  void complete (boost::system::error_code ec);
+
+private:
+  boost::asio::experimental::concurrent_channel<boost::asio::any_io_executor, void (boost::system::error_code)> result;
+};
+
+template <typename Handler>
+concept ReadHandler = std::invocable<Handler &, std::string>;
+
+template <typename Writer>
+concept MessageWriter = std::invocable<Writer &, std::string &>;
 
 template <class T> class MyWebSocket : public std::enable_shared_from_this<MyWebSocket<T> >
 {
 public:
-  explicit MyWebSocket (T &&webSocket_) : webSocket{ std::move (webSocket_) } {}
-  MyWebSocket (T &&webSocket_, std::string loggingName_, std::string id_) : webSocket{ std::move (webSocket_) }, loggingName{ std::move (loggingName_) }, id{ std::move (id_) } {}
+  explicit MyWebSocket (T &&webSocket_) : webSocket{ std::move (webSocket_) } { setUpWebSocket (); }
+  MyWebSocket (T &&webSocket_, std::string loggingName_, std::string id_, MyWebSocketOption myWebSocketOption_ = {}) : webSocket{ std::move (webSocket_) }, loggingName{ std::move (loggingName_) }, id{ std::move (id_) }, myWebSocketOption{ std::move (myWebSocketOption_) } { setUpWebSocket (); }
+  ~MyWebSocket ();
 
-  void queueMessage (std::string message);
+  // queueMessage and queueBinary are thread safe. everything else has to be called from the executor of the web socket
+  // the loops, asyncClose and sendPingToEndpoint keep the web socket alive while they run. the per message functions asyncWriteOneMessage, asyncWriteOneBinaryMessage and asyncReadOneMessage do not. whoever awaits them has to own the web socket
+  bool queueMessage (std::string message, Priority priority = Priority::normal); // returns false if the message will not be sent
+  bool queueMessage (SharedPayload message, Priority priority = Priority::normal); // message is kept alive until it is written so one payload can be queued on many connections without copies
+  bool queueBinary (std::span<std::byte const> message, Priority priority = Priority::normal);
+  bool queueMessage (std::string key, std::string message, Priority priority = Priority::normal); // replaces a not yet written message with the same key in place so a slow consumer only gets the latest message per key. the replacing message keeps the place and priority of the replaced one and priority only applies to a new entry
+  bool queueMessage (std::string key, SharedPayload message, Priority priority = Priority::normal);
+  std::shared_ptr<WriteCompletion> queueTrackedMessage (std::string message, Priority priority = Priority::normal); // same as queueMessage but the returned completion tells when the message reached the socket
+  std::shared_ptr<WriteCompletion> queueTrackedMessage (SharedPayload message, Priority priority = Priority::normal);
+  template <MessageWriter Writer> bool queueMessageWith (std::size_t sizeHint, Writer writer, Priority priority = Priority::normal); // writer appends the message to an empty pooled buffer with at least sizeHint capacity so no temporary string is needed
+  std::size_t queueDepth () const;
+  std::size_t queuedByteCount () const;
+  std::size_t droppedMessageCount () const;
+  std::optional<std::chrono::nanoseconds> roundTripTime () const; // between the latest ping and its pong. std::nullopt until the first pong arrived
+  std::optional<std::chrono::nanoseconds> smoothedRoundTripTime () const; // moving average which gives every new measurement a weight of 1/8 like tcp does
+  bool isHibernating () const; // true while hibernateAfter released the buffers of the idle connection. the next inbound byte wakes it up
   boost::asio::awaitable<void> readLoop (std::function<void (std::string readResult)> onRead);
+  template <ReadHandler Handler> boost::asio::awaitable<void> readLoop (Handler onRead); // same as the std::function overload but onRead can get inlined into the read coroutine
+  boost::asio::awaitable<void> readLoopView (std::function<void (std::string_view readResult)> onRead); // readResult points into the read buffer and is only valid until onRead returns
+  boost::asio::awaitable<void> readLoopWithOpcode (std::function<void (Opcode opcode, std::span<std::byte const> readResult)> onRead); // readResult points into the read buffer and is only valid until onRead returns. binary messages skip utf-8 validation
+  boost::asio::awaitable<void> readLoopFragments (std::function<void (std::string_view fragment, bool isMessageDone)> onRead, std::size_t maxFragmentSize = 64 * 1024); // delivers messages in pieces of at most maxFragmentSize bytes as they arrive. fragment is only valid until onRead returns
+  boost::asio::awaitable<void> readLoopIntoChannel (); // reading pauses while the channel is full so tcp flow control throttles the sender. get the messages with nextMessage
+  boost::asio::awaitable<std::string> nextMessage ();
   boost::asio::awaitable<void> writeLoop ();
   boost::asio::awaitable<void> asyncWriteOneMessage (std::string message);
+  boost::asio::awaitable<void> asyncWriteOneBinaryMessage (std::span<std::byte const> message);
   boost::asio::awaitable<void> sendPingToEndpoint ();
-  boost::asio::awaitable<void> asyncClose ();
+  void pingEndpointPeriodically (); // same as sendPingToEndpoint but uses the TimerWheel of the execution context instead of a timer and coroutine per connection. stops when the connection closes
+  boost::asio::awaitable<void> asyncClose (boost::beast::websocket::close_reason closeReason = boost::beast::websocket::close_code::normal);
   boost::asio::awaitable<std::string> asyncReadOneMessage ();
+  boost::beast::websocket::close_reason const &closeReason () const; // what the peer sent in its close frame. set once a read failed with boost::beast::websocket::error::closed
 
 private:
+  struct WriteCompletionHandle // fails the write completion if the message gets destroyed before it was written
+  {
+    WriteCompletionHandle () = default;
+    explicit WriteCompletionHandle (std::shared_ptr<WriteCompletion> writeCompletion_) : writeCompletion{ std::move (writeCompletion_) } {}
+    WriteCompletionHandle (WriteCompletionHandle &&) noexcept = default;
+    WriteCompletionHandle &
+    operator= (WriteCompletionHandle &&other) noexcept
+    {
+      if (this != &other)
+        {
+          complete (boost::asio::error::operation_aborted);
+          writeCompletion = std::move (other.writeCompletion);
+        }
+      return *this;
+    }
+    ~WriteCompletionHandle () { complete (boost::asio::error::operation_aborted); }
+
+    void
+    complete (boost::system::error_code ec)
+    {
+      if (writeCompletion) std::exchange (writeCompletion, nullptr)->complete (ec);
+    }
+
+    std::shared_ptr<WriteCompletion> writeCompletion{};
+  };
+
+  struct QueuedMessage
+  {
+    std::string_view
+    view () const
+    {
+      if (auto const *sharedPayload = std::get_if<SharedPayload> (&payload)) return **sharedPayload;
+      return std::get<std::string> (payload);
+    }
+
+    std::variant<std::string, SharedPayload> payload{};
+    Opcode opcode{ Opcode::text };
+    Priority priority{ Priority::normal };
+    std::optional<std::string> conflationKey{};
+    bool fromSendBufferPool{}; // only these buffers go back to the pool so other messages do not take its lock
+    WriteCompletionHandle writeCompletionHandle{};
+  };
+
   std::string rndNumberAsString ();
+  void setUpWebSocket ();
+  bool enqueue (QueuedMessage message);
+  void resetReadBuffer ();
+  std::string_view readBufferView () const;
+  boost::asio::awaitable<void> asyncReadIntoReadBuffer ();
+  boost::asio::awaitable<bool> asyncReadFirstByteIntoReadBuffer (); // returns true if that was the whole message
+  boost::asio::awaitable<void> asyncWrite (std::string_view message, Opcode opcode);
+  void onReadLoopEnd ();
+  void onWriteLoopEnd ();
+  bool isOverMemoryBudget (std::size_t additionalBytes = 0) const;
+  bool isQueueFull (std::size_t additionalMessages, std::size_t additionalBytes) const;
+  void wakeUpWriteLoop ();
+  void drainInbox ();
+  void failQueuedMessages (); // drops every message that was not written yet and fails its write completion. called once nothing will write anymore
+  std::size_t msgQueueSize () const;
+  QueuedMessage popFrontOfMsgQueue (std::size_t lane);
+  std::string takeSendBuffer (std::size_t sizeHint);
+  void recycleSendBuffer (QueuedMessage message);
+  bool cork (bool enable);
+  std::optional<TimerWheel::EntryId> scheduleOnTimerWheel (std::chrono::steady_clock::duration delay, void (MyWebSocket::*onExpiry) ()); // onExpiry runs on the executor of the web socket. std::nullopt if the connection is done
+  void cancelTimers ();
+  void schedulePing (std::chrono::steady_clock::duration delay);
+  void sendScheduledPing ();
+  std::chrono::steady_clock::duration timeUntilNextPing () const; // zero if a ping is due
+  void scheduleHibernationCheck (std::chrono::steady_clock::duration delay);
+  void hibernateIfIdle ();
+  boost::beast::websocket::ping_data startPing (); // returns the ping payload which carries the send time so its pong tells the round trip time
+  void checkPong ();
+  void onPong (std::string_view payload);
 
   T webSocket{};
   std::string loggingName{};
   std::string id{ rndNumberAsString () };
-  std::deque<std::string> msgQueue{};
-  CoroTimer pingTimer{ webSocket.get_executor () };
+  MyWebSocketOption myWebSocketOption{};
+  boost::beast::flat_buffer readBuffer{};
+  std::atomic_size_t readBufferSize{}; // bytes of the message onRead currently holds. spare capacity is not counted against memoryBudget
+  boost::lockfree::queue<QueuedMessage *> inbox{ 0 }; // producers on any thread push here. drainInbox moves the messages into msgQueue on the executor. starts without preallocated nodes because every node takes a cache line. push allocates nodes as needed and they get reused after that
+  std::atomic_bool wakeUpPending{};
+  std::array<std::deque<QueuedMessage>, 2> msgQueue{}; // one lane per Priority
+  std::unordered_map<std::string, QueuedMessage *> conflatedMessages{}; // points into msgQueue. deque keeps references stable on push_back and pop_front
+  std::atomic_size_t queuedMessages{}; // counts messages in inbox and msgQueue
+  std::atomic_size_t queuedBytes{};
+  std::atomic_size_t droppedMessages{};
+  std::atomic<std::chrono::nanoseconds::rep> lastReadAt{}; // CoarseSteadyClock
+  std::atomic<std::chrono::nanoseconds::rep> unansweredPingSentAt{}; // 0 if every ping got answered
+  std::atomic<std::chrono::nanoseconds::rep> latestRoundTripTime{}; // 0 until the first pong arrived
+  std::atomic<std::chrono::nanoseconds::rep> smoothedRoundTripTimeValue{};
+  bool waitingForMessage{};
+  std::optional<TimerWheel::EntryId> scheduledPing{}; // timer wheel entries get cancelled when the connection is done so they do not keep the execution context busy
+  std::optional<TimerWheel::EntryId> scheduledPongCheck{};
+  std::optional<TimerWheel::EntryId> scheduledHibernationCheck{};
+  std::atomic_bool hibernating{};
+  std::mutex sendBufferPoolMutex{};
+  std::vector<std::string> sendBufferPool{};
+  SteadyCoroTimer pingTimer{ webSocket.get_executor () };
   std::atomic_bool running{ true };
   boost::asio::experimental::channel<boost::asio::any_io_executor, void (boost::system::error_code)> writeSignal{ webSocket.get_executor (), 1 };
+  boost::asio::experimental::channel<boost::asio::any_io_executor, void (boost::system::error_code, std::string)> inboundMessages{ webSocket.get_executor (), myWebSocketOption.inboundMessageChannelSize };
 };
 
+template <class T>
+template <ReadHandler Handler>
+boost::asio::awaitable<void>
+MyWebSocket<T>::readLoop (Handler onRead)
+{
+  [[maybe_unused]] auto self = this->shared_from_this ();
+  try
+    {
+      for (;;)
+        {
+          co_await asyncReadIntoReadBuffer ();
+          onRead (std::string{ readBufferView () });
+        }
+    }
+  catch (...)
+    {
+      onReadLoopEnd ();
+      throw;
+    }
+}
+
+template <class T>
+template <MessageWriter Writer>
+bool
+MyWebSocket<T>::queueMessageWith (std::size_t sizeHint, Writer writer, Priority priority)
+{
+  auto sendBuffer = takeSendBuffer (sizeHint);
+  writer (sendBuffer);
+  return enqueue ({ .payload = std::move (sendBuffer), .opcode = Opcode::text, .priority = priority, .fromSendBufferPool = true });
+}
+
 }
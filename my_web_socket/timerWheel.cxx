@@ -0,0 +1,116 @@
+#include "my_web_socket/timerWheel.hxx"
+#include <boost/asio/execution/context.hpp>
+#include <boost/asio/query.hpp>
+#include <algorithm>
+
+namespace my_web_socket
+{
+
+boost::asio::execution_context::id TimerWheel::id;
+
+TimerWheel::TimerWheel (boost::asio::execution_context &executionContext) : boost::asio::execution_context::service{ executionContext } {}
+
+TimerWheel &
+TimerWheel::of (boost::asio::any_io_executor const &executor)
+{
+  auto &timerWheel = boost::asio::use_service<TimerWheel> (boost::asio::query (executor, boost::asio::execution::context));
+  auto lock = std::scoped_lock{ timerWheel.entriesMutex };
+  if (not timerWheel.timer) timerWheel.timer.emplace (executor);
+  return timerWheel;
+}
+
+TimerWheel::EntryId
+TimerWheel::schedule (std::chrono::steady_clock::duration delay, std::function<void ()> onExpiry)
+{
+  auto const ticks = std::max (std::size_t{ 1 }, static_cast<std::size_t> ((std::max (delay, std::chrono::steady_clock::duration{}) + tickDuration - std::chrono::steady_clock::duration{ 1 }) / tickDuration));
+  auto lock = std::scoped_lock{ entriesMutex };
+  auto const slot = (currentSlot + ticks) % slotCount;
+  auto const entryId = ++nextEntryId;
+  slots[slot].push_back ({ .id = entryId, .remainingRounds = (ticks - 1) / slotCount, .onExpiry = std::move (onExpiry) });
+  slotOfEntry.emplace (entryId, slot);
+  ++entryCount;
+  if (not ticking)
+    {
+      ticking = true;
+      timer->expires_after (tickDuration);
+      waitForNextTick ();
+    }
+  return entryId;
+}
+
+bool
+TimerWheel::cancel (EntryId entryId)
+{
+  auto lock = std::scoped_lock{ entriesMutex };
+  auto const slotOfCancelledEntry = slotOfEntry.find (entryId);
+  if (slotOfCancelledEntry == slotOfEntry.end ()) return false;
+  std::erase_if (slots[slotOfCancelledEntry->second], [entryId] (Entry const &entry) { return entry.id == entryId; });
+  slotOfEntry.erase (slotOfCancelledEntry);
+  --entryCount;
+  if (entryCount == 0 && ticking)
+    {
+      ticking = false;
+      timer->cancel (); // nothing left to tick for so io_context::run does not have to wait for the next tick
+    }
+  return true;
+}
+
+std::size_t
+TimerWheel::scheduledCount () const
+{
+  auto lock = std::scoped_lock{ entriesMutex };
+  return entryCount;
+}
+
+void
+TimerWheel::shutdown ()
+{
+  auto lock = std::scoped_lock{ entriesMutex };
+  for (auto &slot : slots)
+    slot.clear ();
+  slotOfEntry.clear ();
+  entryCount = 0;
+  timer.reset ();
+}
+
+void
+TimerWheel::waitForNextTick ()
+{
+  timer->async_wait (
+      [this] (boost::system::error_code ec)
+        {
+          if (not ec) tick ();
+        });
+}
+
+void
+TimerWheel::tick ()
+{
+  auto due = std::vector<std::function<void ()> >{};
+  {
+    auto lock = std::scoped_lock{ entriesMutex };
+    currentSlot = (currentSlot + 1) % slotCount;
+    auto &slot = slots[currentSlot];
+    auto const firstDue = std::partition (slot.begin (), slot.end (), [] (Entry const &entry) { return entry.remainingRounds != 0; });
+    for (auto entry = firstDue; entry != slot.end (); ++entry)
+      {
+        slotOfEntry.erase (entry->id);
+        due.push_back (std::move (entry->onExpiry));
+      }
+    slot.erase (firstDue, slot.end ());
+    for (auto &entry : slot)
+      --entry.remainingRounds;
+    entryCount -= due.size ();
+    if (entryCount != 0)
+      {
+        timer->expires_at (timer->expiry () + tickDuration); // relative to the last expiry so ticks do not drift
+        waitForNextTick ();
+      }
+    else
+      ticking = false;
+  }
+  for (auto &onExpiry : due)
+    onExpiry ();
+}
+
+}
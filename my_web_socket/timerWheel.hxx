@@ -0,0 +1,57 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace my_web_socket
+{
+
+// hashed timer wheel shared by everything running on one execution context. one steady timer ticks for all scheduled callbacks instead of one timer per connection in the reactor's timer heap
+class TimerWheel : public boost::asio::execution_context::service
+{
+public:
+  static boost::asio::execution_context::id id;
+  static constexpr auto tickDuration = std::chrono::milliseconds{ 100 };
+  static constexpr auto slotCount = std::size_t{ 512 };
+  using EntryId = std::uint64_t;
+
+  explicit TimerWheel (boost::asio::execution_context &executionContext);
+  static TimerWheel &of (boost::asio::any_io_executor const &executor); // the first call creates the wheel and its timer on executor
+
+  EntryId schedule (std::chrono::steady_clock::duration delay, std::function<void ()> onExpiry); // onExpiry runs once after delay with a precision of one tick on the executor the wheel got created with. thread safe
+  bool cancel (EntryId entryId); // false if onExpiry already ran or got cancelled. the wheel stops ticking once nothing is scheduled so io_context::run can return. thread safe
+  std::size_t scheduledCount () const;
+
+private:
+  struct Entry
+  {
+    EntryId id{};
+    std::size_t remainingRounds{};
+    std::function<void ()> onExpiry{};
+  };
+
+  void shutdown () override;
+  void waitForNextTick ();
+  void tick ();
+
+  mutable std::mutex entriesMutex{};
+  std::array<std::vector<Entry>, slotCount> slots{};
+  std::size_t currentSlot{};
+  std::size_t entryCount{};
+  EntryId nextEntryId{};
+  std::unordered_map<EntryId, std::size_t> slotOfEntry{}; // so cancel does not have to search every slot
+  bool ticking{};
+  std::optional<boost::asio::steady_timer> timer{};
+};
+
+}
@@ -0,0 +1,505 @@
+#include "my_web_socket/broadcaster.hxx"
+#include "my_web_socket/coSpawnTraced.hxx"
+#include "my_web_socket/test_cert/testCertClient.hxx"
+#include "my_web_socket/test_cert/testCertServer.hxx"
+#include "util.hxx"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace boost::asio::experimental::awaitable_operators;
+
+namespace
+{
+// connects a server and a client on ioContext and starts the read loop of the client with startReadLoop. returns the server once the connection is set up so samples only measure reading
+template <typename StartReadLoop>
+std::tuple<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >, std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >
+connectAndStartReadLoop (boost::asio::io_context &ioContext, StartReadLoop startReadLoop)
+{
+  auto connection = std::optional<std::tuple<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >, std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > > >{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&connection, startReadLoop] () -> boost::asio::awaitable<void>
+        {
+          auto [server, client] = co_await createConnectedMyWebSockets ();
+          auto executor = co_await boost::asio::this_coro::executor;
+          my_web_socket::coSpawnTraced (executor, server->writeLoop () && server->readLoop ([] (auto) {}), "benchmark server", [server] (auto) {});
+          my_web_socket::coSpawnTraced (executor, startReadLoop (client), "benchmark client", [client] (auto) {});
+          connection.emplace (server, client);
+        },
+      "benchmark");
+  while (not connection)
+    ioContext.run_one ();
+  return connection.value ();
+}
+
+// server sends messageCount messages on an established connection. returns the number of messages the client read
+size_t
+readMessages (boost::asio::io_context &ioContext, my_web_socket::MyWebSocket<my_web_socket::WebSocket> &server, size_t messageCount, size_t &messagesRead)
+{
+  messagesRead = 0;
+  for (auto i = size_t{}; i < messageCount; ++i)
+    server.queueMessage ("message");
+  while (messagesRead != messageCount)
+    ioContext.run_one ();
+  return messagesRead;
+}
+
+// connects from 127.0.0.2, 127.0.0.3, ... so more connections than ephemeral ports are possible
+boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >
+createMyWebSocketFrom (boost::asio::ip::tcp::endpoint endpoint, size_t connectionNumber, my_web_socket::MyWebSocketOption const &myWebSocketOption, std::optional<boost::beast::websocket::permessage_deflate> const &permessageDeflate)
+{
+  auto webSocket = my_web_socket::WebSocket{ co_await boost::asio::this_coro::executor };
+  if (permessageDeflate) webSocket.set_option (permessageDeflate.value ());
+  auto &socket = boost::beast::get_lowest_layer (webSocket).socket ();
+  socket.open (boost::asio::ip::tcp::v4 ());
+  socket.bind ({ boost::asio::ip::address_v4{ static_cast<boost::asio::ip::address_v4::uint_type> (0x7F000002 + connectionNumber / 20'000) }, 0 });
+  co_await boost::beast::get_lowest_layer (webSocket).async_connect (endpoint);
+  co_await webSocket.async_handshake (endpoint.address ().to_string () + std::to_string (endpoint.port ()), "/");
+  co_return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (std::move (webSocket), "client", std::to_string (connectionNumber), myWebSocketOption);
+}
+
+// connects connectionCount clients. onServerConnected gets every server side connection. clients count the messages they read in messagesRead. returns the clients
+std::vector<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >
+connectClients (boost::asio::io_context &ioContext, std::function<void (std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > const &)> onServerConnected, size_t &messagesRead, size_t connectionCount, my_web_socket::MyWebSocketOption const &myWebSocketOption = {}, std::optional<boost::beast::websocket::permessage_deflate> const &permessageDeflate = {})
+{
+  auto clients = std::vector<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >{};
+  auto connectionsEstablished = bool{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&onServerConnected, &messagesRead, &connectionsEstablished, &clients, connectionCount, &myWebSocketOption, &permessageDeflate] () -> boost::asio::awaitable<void>
+        {
+          auto executor = co_await boost::asio::this_coro::executor;
+          auto acceptor = boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor>{ executor, { boost::asio::ip::make_address ("127.0.0.1"), 0 } };
+          for (auto i = size_t{}; i < connectionCount; ++i)
+            {
+              auto [server, client] = co_await (acceptMyWebSocket (acceptor, myWebSocketOption, permessageDeflate) && createMyWebSocketFrom (acceptor.local_endpoint (), i, myWebSocketOption, permessageDeflate));
+              onServerConnected (server);
+              my_web_socket::coSpawnTraced (executor, server->writeLoop () && server->readLoop ([] (auto) {}), "benchmark server", [server] (auto) {});
+              my_web_socket::coSpawnTraced (executor, client->readLoop ([&messagesRead] (std::string) { ++messagesRead; }), "benchmark client", [client] (auto) {});
+              clients.push_back (client);
+            }
+          connectionsEstablished = true;
+        },
+      "benchmark");
+  while (not connectionsEstablished)
+    ioContext.run_one ();
+  return clients;
+}
+
+// connects a server and a client, starts the writeLoop of the server and a client read loop that counts messages and closes the connection after messageCount messages. onConnected gets the server once both sides run. onMessageRead gets the server and the messages read so far after every message except the last. runs ioContext until the connection is closed and returns the number of messages the client read
+size_t
+writeToCountingClient (boost::asio::io_context &ioContext, size_t messageCount, std::function<void (std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > const &server)> onConnected, std::function<void (my_web_socket::MyWebSocket<my_web_socket::WebSocket> &server, size_t messagesRead)> onMessageRead = {}, my_web_socket::MyWebSocketOption const &serverOption = {}, std::optional<boost::beast::websocket::permessage_deflate> const &permessageDeflate = {})
+{
+  auto messagesRead = size_t{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&messagesRead, &onConnected, &onMessageRead, &serverOption, &permessageDeflate, messageCount] () -> boost::asio::awaitable<void>
+        {
+          auto [server, client] = co_await createConnectedMyWebSockets (serverOption, {}, permessageDeflate);
+          auto executor = co_await boost::asio::this_coro::executor;
+          my_web_socket::coSpawnTraced (executor, server->writeLoop () && server->readLoop ([] (auto) {}), "benchmark server", [server] (auto) {});
+          my_web_socket::coSpawnTraced (executor,
+                                        client->readLoop (
+                                            [&messagesRead, &onMessageRead, messageCount, server, client, executor] (std::string)
+                                              {
+                                                if (++messagesRead == messageCount)
+                                                  my_web_socket::coSpawnTraced (executor, client->asyncClose (), "benchmark client asyncClose");
+                                                else if (onMessageRead)
+                                                  onMessageRead (*server, messagesRead);
+                                              }),
+                                        "benchmark client", [client] (auto) {});
+          onConnected (server);
+        },
+      "benchmark");
+  ioContext.run ();
+  return messagesRead;
+}
+
+void
+closeClients (boost::asio::io_context &ioContext, std::vector<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > > &clients)
+{
+  for (auto &client : clients)
+    my_web_socket::coSpawnTraced (ioContext, client->asyncClose (), "benchmark client asyncClose");
+  clients.clear ();
+  ioContext.run ();
+}
+
+size_t
+residentBytes ()
+{
+  auto statm = std::ifstream{ "/proc/self/statm" };
+  auto size = size_t{};
+  auto residentPages = size_t{};
+  statm >> size >> residentPages;
+  return residentPages * static_cast<size_t> (sysconf (_SC_PAGESIZE));
+}
+
+std::chrono::microseconds
+cpuTime ()
+{
+  auto usage = rusage{};
+  getrusage (RUSAGE_SELF, &usage);
+  return std::chrono::seconds{ usage.ru_utime.tv_sec + usage.ru_stime.tv_sec } + std::chrono::microseconds{ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec };
+}
+
+// writer writes messageCount messages one by one with asyncWriteOneMessage and reader reads each with asyncReadOneMessage. returns the number of messages read
+template <class T>
+size_t
+writeAndReadOneByOne (boost::asio::io_context &ioContext, std::shared_ptr<my_web_socket::MyWebSocket<T> > const &writer, std::shared_ptr<my_web_socket::MyWebSocket<T> > const &reader, size_t messageCount)
+{
+  auto messagesRead = size_t{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&writer, &reader, &messagesRead, messageCount] () -> boost::asio::awaitable<void>
+        {
+          for (auto i = size_t{}; i < messageCount; ++i)
+            {
+              co_await writer->asyncWriteOneMessage ("message");
+              co_await reader->asyncReadOneMessage ();
+              ++messagesRead;
+            }
+        },
+      "benchmark");
+  ioContext.run ();
+  ioContext.restart ();
+  return messagesRead;
+}
+
+// every connection needs 2 file descriptors because client and server run in this process
+bool
+enoughFileDescriptorsFor (size_t connectionCount)
+{
+  auto limit = rlimit{};
+  getrlimit (RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit (RLIMIT_NOFILE, &limit);
+  return limit.rlim_cur > 2 * connectionCount + 100;
+}
+
+// server queues the next burstSize messages after the client read the previous burst. returns the number of messages the client read
+size_t
+sendInBursts (size_t messageCount, size_t burstSize, my_web_socket::FlushMode flushMode)
+{
+  auto ioContext = boost::asio::io_context{};
+  auto const queueBurst = [burstSize] (my_web_socket::MyWebSocket<my_web_socket::WebSocket> &server)
+    {
+      for (auto i = size_t{}; i < burstSize; ++i)
+        server.queueMessage ("message");
+    };
+  return writeToCountingClient (
+      ioContext, messageCount, [&queueBurst] (auto const &server) { queueBurst (*server); },
+      [&queueBurst, burstSize] (auto &server, size_t messagesRead)
+        {
+          if (messagesRead % burstSize == 0) queueBurst (server);
+        },
+      { .flushMode = flushMode });
+}
+
+// producerCount threads queue messageCount messages together. returns the number of messages the client read
+size_t
+queueFromThreads (size_t messageCount, size_t producerCount)
+{
+  auto ioContext = boost::asio::io_context{};
+  auto producers = std::vector<std::thread>{};
+  auto const messagesRead = writeToCountingClient (ioContext, messageCount,
+                                                   [&producers, producerCount, messagesPerProducer = messageCount / producerCount] (auto const &server)
+                                                     {
+                                                       for (auto i = size_t{}; i < producerCount; ++i)
+                                                         producers.emplace_back (
+                                                             [server, messagesPerProducer] ()
+                                                               {
+                                                                 for (auto j = size_t{}; j < messagesPerProducer; ++j)
+                                                                   server->queueMessage ("message");
+                                                               });
+                                                     });
+  for (auto &producer : producers)
+    producer.join ();
+  return messagesRead;
+}
+
+// order book updates like a market data feed sends them
+std::string
+jsonPayload (size_t levelCount)
+{
+  auto payload = std::string{ R"({"type":"orderBookUpdate","symbol":"BTC-USD","sequence":184467,"levels":[)" };
+  for (auto i = size_t{}; i < levelCount; ++i)
+    {
+      if (i != 0) payload += ',';
+      payload += R"({"side":")" + std::string{ i % 2 == 0 ? "bid" : "ask" } + R"(","price":")" + std::to_string (64000 + i * 7) + '.' + std::to_string (i % 100) + R"(","quantity":")" + std::to_string (i * 13 % 1000) + R"(.25","orderCount":)" + std::to_string (i % 17) + '}';
+    }
+  return payload + R"(],"timestamp":"2024-05-14T09:31:22.481Z"})";
+}
+
+std::optional<boost::beast::websocket::permessage_deflate>
+deflateOnBothSides (std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate)
+{
+  if (permessageDeflate)
+    {
+      permessageDeflate->server_enable = true;
+      permessageDeflate->client_enable = true;
+    }
+  return permessageDeflate;
+}
+
+// server writes message messageCount times and closes the connection. returns the bytes the client read from the tcp socket after the handshake
+size_t
+bytesOnWire (std::optional<boost::beast::websocket::permessage_deflate> const &permessageDeflate, std::string const &message, size_t messageCount)
+{
+  auto ioContext = boost::asio::io_context{};
+  auto bytesRead = size_t{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&permessageDeflate, &message, &bytesRead, messageCount] () -> boost::asio::awaitable<void>
+        {
+          auto executor = co_await boost::asio::this_coro::executor;
+          auto acceptor = boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor>{ executor, { boost::asio::ip::make_address ("127.0.0.1"), 0 } };
+          auto client = my_web_socket::WebSocket{ executor };
+          if (permessageDeflate) client.set_option (permessageDeflate.value ());
+          co_await boost::beast::get_lowest_layer (client).async_connect (acceptor.local_endpoint ());
+          auto server = co_await (acceptMyWebSocket (acceptor, {}, permessageDeflate) && client.async_handshake ("127.0.0.1", "/", boost::asio::use_awaitable));
+          my_web_socket::coSpawnTraced (
+              executor,
+              [server, &message, messageCount] () -> boost::asio::awaitable<void>
+                {
+                  for (auto i = size_t{}; i < messageCount; ++i)
+                    co_await server->asyncWriteOneMessage (message);
+                  co_await server->asyncClose ();
+                }(),
+              "benchmark server");
+          auto buffer = std::array<char, 64 * 1024>{};
+          auto ec = boost::system::error_code{};
+          while (not ec)
+            bytesRead += co_await boost::beast::get_lowest_layer (client).async_read_some (boost::asio::buffer (buffer), boost::asio::redirect_error (boost::asio::use_awaitable, ec));
+        },
+      "benchmark");
+  ioContext.run ();
+  return bytesRead;
+}
+
+// server writes message messageCount times. client reads and inflates them. returns the number of messages the client read
+size_t
+writeAndReadMessages (std::optional<boost::beast::websocket::permessage_deflate> const &permessageDeflate, std::string const &message, size_t messageCount)
+{
+  auto ioContext = boost::asio::io_context{};
+  return writeToCountingClient (
+      ioContext, messageCount,
+      [&message, messageCount] (auto const &server)
+        {
+          for (auto i = size_t{}; i < messageCount; ++i)
+            server->queueMessage (message);
+        },
+      {}, {}, permessageDeflate);
+}
+}
+
+TEST_CASE ("readLoop dispatch", "[.benchmark]")
+{
+  constexpr auto messageCount = size_t{ 10'000 };
+  auto ioContext = boost::asio::io_context{};
+  auto messagesRead = size_t{};
+  auto const handler = [&messagesRead] (std::string) { ++messagesRead; };
+  auto [stdFunctionServer, stdFunctionClient] = connectAndStartReadLoop (ioContext, [&handler] (auto client) { return client->readLoop (std::function<void (std::string readResult)>{ handler }); });
+  auto [templateServer, templateClient] = connectAndStartReadLoop (ioContext, [&handler] (auto client) { return client->readLoop (handler); });
+  BENCHMARK ("std::function handler 10'000 messages") { return readMessages (ioContext, *stdFunctionServer, messageCount, messagesRead); };
+  BENCHMARK ("template handler 10'000 messages") { return readMessages (ioContext, *templateServer, messageCount, messagesRead); };
+  auto clients = std::vector{ stdFunctionClient, templateClient };
+  closeClients (ioContext, clients);
+}
+
+TEST_CASE ("writeLoop flush mode", "[.benchmark]")
+{
+  constexpr auto messageCount = size_t{ 10'000 };
+  for (auto burstSize : { size_t{ 1 }, size_t{ 10 }, size_t{ 100 } })
+    {
+      BENCHMARK ("perMessage 10'000 messages in bursts of " + std::to_string (burstSize)) { return sendInBursts (messageCount, burstSize, my_web_socket::FlushMode::perMessage); };
+      BENCHMARK ("batched 10'000 messages in bursts of " + std::to_string (burstSize)) { return sendInBursts (messageCount, burstSize, my_web_socket::FlushMode::batched); };
+    }
+}
+
+TEST_CASE ("broadcaster fan out", "[.benchmark]")
+{
+  for (auto connectionCount : { size_t{ 1'000 }, size_t{ 10'000 }, size_t{ 50'000 } })
+    {
+      if (not enoughFileDescriptorsFor (connectionCount))
+        {
+          WARN ("skipping fan out to " << connectionCount << " connections. not enough file descriptors");
+          continue;
+        }
+      auto ioContext = boost::asio::io_context{};
+      auto broadcaster = my_web_socket::Broadcaster<my_web_socket::WebSocket>{};
+      auto messagesRead = size_t{};
+      auto clients = connectClients (ioContext, [&broadcaster] (auto const &server) { broadcaster.subscribe (server); }, messagesRead, connectionCount);
+      BENCHMARK ("broadcast 4 KB to " + std::to_string (connectionCount) + " connections")
+      {
+        messagesRead = 0;
+        broadcaster.broadcast (std::string (4096, 'a'));
+        while (messagesRead != connectionCount)
+          ioContext.run_one ();
+        return messagesRead;
+      };
+      closeClients (ioContext, clients);
+    }
+}
+
+TEST_CASE ("broadcaster fan out with permessage-deflate", "[.benchmark]")
+{
+  constexpr auto connectionCount = size_t{ 10'000 };
+  if (not enoughFileDescriptorsFor (connectionCount))
+    {
+      WARN ("skipping fan out to " << connectionCount << " connections. not enough file descriptors");
+      return;
+    }
+  auto ioContext = boost::asio::io_context{};
+  auto broadcaster = my_web_socket::Broadcaster<my_web_socket::WebSocket>{};
+  auto messagesRead = size_t{};
+  auto clients = connectClients (ioContext, [&broadcaster] (auto const &server) { broadcaster.subscribe (server); }, messagesRead, connectionCount, {}, deflateOnBothSides (boost::beast::websocket::permessage_deflate{ .server_no_context_takeover = true, .client_no_context_takeover = true }));
+  auto const message = std::make_shared<std::string const> (jsonPayload (50));
+  BENCHMARK ("broadcast " + std::to_string (message->size ()) + " byte json to 10'000 connections")
+  {
+    messagesRead = 0;
+    broadcaster.broadcast (message);
+    while (messagesRead != connectionCount)
+      ioContext.run_one ();
+    return messagesRead;
+  };
+  closeClients (ioContext, clients);
+}
+
+TEST_CASE ("queueMessage from multiple threads", "[.benchmark]")
+{
+  constexpr auto messageCount = size_t{ 16'000 };
+  for (auto producerCount : { size_t{ 1 }, size_t{ 4 }, size_t{ 16 } })
+    {
+      BENCHMARK ("16'000 messages from " + std::to_string (producerCount) + " producer threads") { return queueFromThreads (messageCount, producerCount); };
+    }
+}
+
+TEST_CASE ("permessage-deflate", "[.benchmark]")
+{
+  constexpr auto messageCount = size_t{ 1'000 };
+  auto const settings = std::vector<std::tuple<std::string, std::optional<boost::beast::websocket::permessage_deflate> > >{
+    { "uncompressed", std::nullopt },
+    { "compLevel 1", boost::beast::websocket::permessage_deflate{ .compLevel = 1 } },
+    { "compLevel 6", boost::beast::websocket::permessage_deflate{ .compLevel = 6 } },
+    { "compLevel 9", boost::beast::websocket::permessage_deflate{ .compLevel = 9 } },
+    { "compLevel 6 no context takeover", boost::beast::websocket::permessage_deflate{ .server_no_context_takeover = true, .client_no_context_takeover = true, .compLevel = 6 } },
+    { "compLevel 6 window bits 9", boost::beast::websocket::permessage_deflate{ .server_max_window_bits = 9, .client_max_window_bits = 9, .compLevel = 6 } },
+  };
+  for (auto levelCount : { size_t{ 2 }, size_t{ 50 } })
+    {
+      auto const message = jsonPayload (levelCount);
+      for (auto const &[name, permessageDeflate] : settings)
+        {
+          auto const deflate = deflateOnBothSides (permessageDeflate);
+          WARN (name << " " << message.size () << " byte json: " << bytesOnWire (deflate, message, messageCount) / messageCount << " bytes on the wire per message");
+          BENCHMARK (name + " 1'000 messages of " + std::to_string (message.size ()) + " byte json") { return writeAndReadMessages (deflate, message, messageCount); };
+        }
+    }
+}
+
+TEST_CASE ("idle connections with pings", "[.benchmark]")
+{
+  constexpr auto connectionCount = size_t{ 100'000 };
+  if (not enoughFileDescriptorsFor (connectionCount))
+    {
+      WARN ("skipping pings on " << connectionCount << " idle connections. not enough file descriptors");
+      return;
+    }
+  for (auto useTimerWheel : { false, true })
+    {
+      auto ioContext = boost::asio::io_context{};
+      auto messagesRead = size_t{};
+      auto servers = std::vector<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >{};
+      auto clients = connectClients (ioContext, [&servers] (auto const &server) { servers.push_back (server); }, messagesRead, connectionCount);
+      auto const residentBytesBefore = residentBytes ();
+      for (auto const &server : servers)
+        {
+          if (useTimerWheel)
+            server->pingEndpointPeriodically ();
+          else
+            my_web_socket::coSpawnTraced (ioContext, server->sendPingToEndpoint (), "benchmark sendPingToEndpoint");
+        }
+      auto const residentBytesPerConnection = (residentBytes () - residentBytesBefore) / connectionCount;
+      auto const cpuTimeBefore = cpuTime ();
+      ioContext.run_for (std::chrono::seconds{ 12 }); // one ping to every connection
+      WARN ((useTimerWheel ? "timer wheel: " : "timer per connection: ") << residentBytesPerConnection << " bytes per connection to arm pings. " << std::chrono::duration_cast<std::chrono::milliseconds> (cpuTime () - cpuTimeBefore).count () << " ms cpu time for 12 idle seconds with one ping round on " << connectionCount << " connections");
+      for (auto const &server : servers)
+        my_web_socket::coSpawnTraced (ioContext, server->asyncClose (), "benchmark server asyncClose");
+      servers.clear ();
+      closeClients (ioContext, clients);
+    }
+}
+
+TEST_CASE ("hibernating idle connections", "[.benchmark]")
+{
+  constexpr auto connectionCount = size_t{ 100'000 };
+  if (not enoughFileDescriptorsFor (connectionCount))
+    {
+      WARN ("skipping hibernation of " << connectionCount << " idle connections. not enough file descriptors");
+      return;
+    }
+  for (auto hibernateAfter : { std::optional<std::chrono::steady_clock::duration>{}, std::optional<std::chrono::steady_clock::duration>{ std::chrono::seconds{ 1 } } })
+    {
+      auto ioContext = boost::asio::io_context{};
+      auto messagesRead = size_t{};
+      auto servers = std::vector<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >{};
+      auto const residentBytesBefore = residentBytes ();
+      auto clients = connectClients (ioContext, [&servers] (auto const &server) { servers.push_back (server); }, messagesRead, connectionCount, { .hibernateAfter = hibernateAfter });
+      WARN ((hibernateAfter ? "hibernation: " : "no hibernation: ") << (residentBytes () - residentBytesBefore) / connectionCount << " resident bytes per connection before the first message. counts client and server side. sizeof (MyWebSocket) is " << sizeof (my_web_socket::MyWebSocket<my_web_socket::WebSocket>));
+      for (auto const &server : servers)
+        server->queueMessage (std::string (16 * 1024, 'a')); // grows the read buffer of the client and leaves a pooled send buffer on the server
+      while (messagesRead != connectionCount)
+        ioContext.run_one ();
+      ioContext.run_for (std::chrono::seconds{ 2 });
+#ifdef __GLIBC__
+      malloc_trim (0);
+#endif
+      WARN ((hibernateAfter ? "hibernation: " : "no hibernation: ") << (residentBytes () - residentBytesBefore) / connectionCount << " resident bytes per idle connection. counts client and server side");
+      for (auto const &server : servers)
+        my_web_socket::coSpawnTraced (ioContext, server->asyncClose (), "benchmark server asyncClose");
+      servers.clear ();
+      closeClients (ioContext, clients);
+    }
+}
+
+TEST_CASE ("per message write and read", "[.benchmark]")
+{
+  constexpr auto messageCount = size_t{ 10'000 };
+  auto ioContext = boost::asio::io_context{};
+  SECTION ("WebSocket")
+  {
+    auto server = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >{};
+    auto client = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >{};
+    my_web_socket::coSpawnTraced (
+        ioContext, [&server, &client] () -> boost::asio::awaitable<void> { std::tie (server, client) = co_await createConnectedMyWebSockets (); }, "benchmark");
+    ioContext.run ();
+    ioContext.restart ();
+    BENCHMARK ("WebSocket 10'000 messages") { return writeAndReadOneByOne (ioContext, client, server, messageCount); };
+    my_web_socket::coSpawnTraced (ioContext, client->asyncClose (), "benchmark client asyncClose");
+    ioContext.run ();
+  }
+  SECTION ("SSLWebSocket")
+  {
+    auto serverSslContext = boost::beast::net::ssl::context{ boost::asio::ssl::context_base::method::tls_server };
+    my_web_socket::test_load_server_certificate (serverSslContext);
+    auto clientSslContext = boost::beast::net::ssl::context{ boost::beast::net::ssl::context::tlsv12_client };
+    my_web_socket::test_load_client_certificate (clientSslContext);
+    auto server = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> >{};
+    auto client = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> >{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&server, &client, &serverSslContext, &clientSslContext] () -> boost::asio::awaitable<void> { std::tie (server, client) = co_await createConnectedMySSLWebSockets (serverSslContext, clientSslContext); },
+        "benchmark");
+    ioContext.run ();
+    ioContext.restart ();
+    BENCHMARK ("SSLWebSocket 10'000 messages") { return writeAndReadOneByOne (ioContext, client, server, messageCount); };
+    my_web_socket::coSpawnTraced (ioContext, client->asyncClose (), "benchmark client asyncClose");
+    ioContext.run ();
+  }
+}
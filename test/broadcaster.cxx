@@ -0,0 +1,76 @@
+#include "my_web_socket/broadcaster.hxx"
+#include "my_web_socket/coSpawnTraced.hxx"
+#include "util.hxx"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace boost::asio::experimental::awaitable_operators;
+
+TEST_CASE ("broadcaster")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto broadcaster = my_web_socket::Broadcaster<my_web_socket::WebSocket>{};
+  SECTION ("broadcast to two connections")
+  {
+    auto queuedOn = size_t{};
+    auto messagesRead = size_t{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&broadcaster, &queuedOn, &messagesRead] () -> boost::asio::awaitable<void>
+          {
+            auto executor = co_await boost::asio::this_coro::executor;
+            for (auto i = 0; i < 2; ++i)
+              {
+                auto [server, client] = co_await createConnectedMyWebSockets ();
+                broadcaster.subscribe (server);
+                my_web_socket::coSpawnTraced (executor, server->writeLoop () && server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+                my_web_socket::coSpawnTraced (executor,
+                                              client->readLoop (
+                                                  [&messagesRead, client, executor] (std::string message)
+                                                    {
+                                                      if (message == "message") ++messagesRead;
+                                                      my_web_socket::coSpawnTraced (executor, client->asyncClose (), "test client asyncClose");
+                                                    }),
+                                              "test client", [client] (auto) {});
+              }
+            queuedOn = broadcaster.broadcast ("message");
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (queuedOn == 2);
+    REQUIRE (messagesRead == 2);
+  }
+  SECTION ("broadcast to connection with permessage-deflate")
+  {
+    auto readResult = std::string{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&broadcaster, &readResult] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets ({}, {}, boost::beast::websocket::permessage_deflate{ .server_enable = true, .client_enable = true });
+            broadcaster.subscribe (server);
+            my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->writeLoop () && server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            broadcaster.broadcast (std::string (1000, 'a'));
+            readResult = co_await client->asyncReadOneMessage ();
+            co_await client->asyncClose ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (readResult == std::string (1000, 'a'));
+  }
+  SECTION ("unsubscribe")
+  {
+    auto myWebSocket = std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (my_web_socket::WebSocket{ ioContext });
+    broadcaster.subscribe (myWebSocket);
+    REQUIRE (broadcaster.subscriberCount () == 1);
+    broadcaster.unsubscribe (myWebSocket);
+    REQUIRE (broadcaster.subscriberCount () == 0);
+  }
+  SECTION ("destroyed connection gets removed on broadcast")
+  {
+    auto myWebSocket = std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (my_web_socket::WebSocket{ ioContext });
+    broadcaster.subscribe (myWebSocket);
+    myWebSocket.reset ();
+    REQUIRE (broadcaster.broadcast ("message") == 0);
+    REQUIRE (broadcaster.subscriberCount () == 0);
+  }
+}
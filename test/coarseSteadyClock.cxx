@@ -0,0 +1,25 @@
+#include "my_web_socket/coarseSteadyClock.hxx"
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+TEST_CASE ("coarseSteadyClock")
+{
+  SECTION ("does not go backwards")
+  {
+    auto previous = my_web_socket::CoarseSteadyClock::now ();
+    for (auto i = 0; i < 1000; ++i)
+      {
+        auto const now = my_web_socket::CoarseSteadyClock::now ();
+        REQUIRE (now >= previous);
+        previous = now;
+      }
+  }
+  SECTION ("follows steady clock within its resolution")
+  {
+    auto const coarseStart = my_web_socket::CoarseSteadyClock::now ();
+    std::this_thread::sleep_for (std::chrono::milliseconds{ 50 });
+    auto const elapsed = my_web_socket::CoarseSteadyClock::now () - coarseStart;
+    REQUIRE (elapsed >= std::chrono::milliseconds{ 40 });
+    REQUIRE (elapsed < std::chrono::seconds{ 1 });
+  }
+}
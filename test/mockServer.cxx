@@ -265,6 +265,32 @@ TEST_CASE ("mockServerOption")
     }
   }
 
+  SECTION ("myWebSocketOption maxMessageSize")
+  {
+    auto ioContext = boost::asio::io_context{};
+    auto success = bool{};
+    mockServerOption.myWebSocketOption.maxMessageSize = 10;
+    auto mockServer = my_web_socket::MockServer<my_web_socket::WebSocket>{ { boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0" };
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&success, &mockServer] () -> boost::asio::awaitable<void>
+          {
+            auto myWebSocket = co_await createMyWebSocket ({ boost::asio::ip::make_address ("127.0.0.1"), mockServer.getPort () });
+            co_await myWebSocket->asyncWriteOneMessage (std::string (100, 'a'));
+            try
+              {
+                co_await myWebSocket->asyncReadOneMessage ();
+              }
+            catch (boost::system::system_error const &e)
+              {
+                success = e.code () == boost::beast::websocket::error::closed;
+              }
+            mockServer.shutDownUsingMockServerIoContext ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (success);
+  }
   SECTION ("mockServerRunTime")
   {
     auto ioContext = boost::asio::io_context{};
@@ -85,6 +85,77 @@ supperTest (my_web_socket::MockServerOption const &defaultMockServerOption, U co
       ioContext.run ();
       REQUIRE (success);
     }
+    SECTION ("send message to mockServer using writeLoop with queueMessage and a shared payload")
+    {
+      auto success = bool{};
+      mockServerOption.callOnMessageStartsWith["my message"] = [&success, &mockServer] ()
+        {
+          success = true;
+          mockServer->shutDownUsingMockServerIoContext ();
+        };
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, myWebSocket->writeLoop () && myWebSocket->readLoop ([] (auto) {}), "test", [myWebSocket] (auto) {});
+              myWebSocket->queueMessage (std::make_shared<std::string const> ("my message"));
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (success);
+    }
+    SECTION ("send message to mockServer using writeLoop with queueMessageWith")
+    {
+      auto success = bool{};
+      mockServerOption.callOnMessageStartsWith["my message 42"] = [&success, &mockServer] ()
+        {
+          success = true;
+          mockServer->shutDownUsingMockServerIoContext ();
+        };
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, myWebSocket->writeLoop () && myWebSocket->readLoop ([] (auto) {}), "test", [myWebSocket] (auto) {});
+              myWebSocket->queueMessageWith (16,
+                                             [] (std::string &sendBuffer)
+                                               {
+                                                 sendBuffer += "my message ";
+                                                 sendBuffer += std::to_string (42);
+                                               });
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (success);
+    }
+    SECTION ("high priority message gets written before normal priority messages")
+    {
+      auto normalReceived = bool{};
+      auto highReceivedFirst = bool{};
+      mockServerOption.callOnMessageStartsWith["normal"] = [&normalReceived] () { normalReceived = true; };
+      mockServerOption.callOnMessageStartsWith["high"] = [&normalReceived, &highReceivedFirst, &mockServer] ()
+        {
+          highReceivedFirst = not normalReceived;
+          mockServer->shutDownUsingMockServerIoContext ();
+        };
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              myWebSocket->queueMessage ("normal");
+              myWebSocket->queueMessage ("high", my_web_socket::Priority::high);
+              my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, myWebSocket->writeLoop () && myWebSocket->readLoop ([] (auto) {}), "test", [myWebSocket] (auto) {});
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (highReceivedFirst);
+    }
     SECTION ("send message to mockServer using writeLoop with queueMessage and read response")
     {
       auto success = bool{};
@@ -113,6 +184,133 @@ supperTest (my_web_socket::MockServerOption const &defaultMockServerOption, U co
       ioContext.run ();
       REQUIRE (success);
     }
+    SECTION ("send message to mockServer and read response using readLoopView")
+    {
+      auto success = bool{};
+      mockServerOption.requestResponse["my message"] = "response";
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), &success, &mockServer, createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor,
+                                            myWebSocket->readLoopView (
+                                                [&success, &mockServer, myWebSocket] (std::string_view message)
+                                                  {
+                                                    if (message == "response")
+                                                      {
+                                                        success = true;
+                                                        mockServer->shutDownUsingMockServerIoContext ();
+                                                      }
+                                                  }),
+                                            "test");
+              co_await myWebSocket->asyncWriteOneMessage ("my message");
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (success);
+    }
+    SECTION ("send binary message to mockServer using queueBinary and read response using readLoopWithOpcode")
+    {
+      auto success = bool{};
+      mockServerOption.requestResponse["my message"] = "response";
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), &success, &mockServer, createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor,
+                                            myWebSocket->writeLoop ()
+                                                && myWebSocket->readLoopWithOpcode (
+                                                    [&success, &mockServer, myWebSocket] (my_web_socket::Opcode opcode, std::span<std::byte const> message)
+                                                      {
+                                                        if (opcode == my_web_socket::Opcode::text && std::string_view{ reinterpret_cast<char const *> (message.data ()), message.size () } == "response")
+                                                          {
+                                                            success = true;
+                                                            mockServer->shutDownUsingMockServerIoContext ();
+                                                          }
+                                                      }),
+                                            "test", [myWebSocket] (auto) {});
+              auto const message = std::string_view{ "my message" };
+              myWebSocket->queueBinary (std::as_bytes (std::span{ message }));
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (success);
+    }
+    SECTION ("send message to mockServer and read response using readLoopFragments")
+    {
+      auto success = bool{};
+      mockServerOption.requestResponse["my message"] = "response";
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), &success, &mockServer, createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor,
+                                            myWebSocket->readLoopFragments (
+                                                [&success, &mockServer, myWebSocket, message = std::string{}, fragmentCount = size_t{}] (std::string_view fragment, bool isMessageDone) mutable
+                                                  {
+                                                    message += fragment;
+                                                    ++fragmentCount;
+                                                    if (isMessageDone)
+                                                      {
+                                                        success = message == "response" && fragmentCount >= 3;
+                                                        mockServer->shutDownUsingMockServerIoContext ();
+                                                      }
+                                                  },
+                                                3),
+                                            "test");
+              co_await myWebSocket->asyncWriteOneMessage ("my message");
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (success);
+    }
+    SECTION ("send message to mockServer and read response using readLoopIntoChannel and nextMessage")
+    {
+      auto success = bool{};
+      mockServerOption.requestResponse["my message"] = "response";
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), &success, &mockServer, createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, myWebSocket->readLoopIntoChannel (), "test", [myWebSocket] (auto) {});
+              co_await myWebSocket->asyncWriteOneMessage ("my message");
+              success = co_await myWebSocket->nextMessage () == "response";
+              mockServer->shutDownUsingMockServerIoContext ();
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (success);
+    }
+    SECTION ("read responses of different length one after another")
+    {
+      auto success = bool{};
+      mockServerOption.requestResponse["long"] = "a long response";
+      mockServerOption.requestResponse["short"] = "short";
+      mockServer = std::make_unique<my_web_socket::MockServer<T> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+      my_web_socket::coSpawnTraced (
+          ioContext,
+          [port = mockServer->getPort (), &success, &mockServer, createWebsocket] () -> boost::asio::awaitable<void>
+            {
+              auto myWebSocket = co_await createWebsocket (port);
+              co_await myWebSocket->asyncWriteOneMessage ("long");
+              auto const longResponse = co_await myWebSocket->asyncReadOneMessage ();
+              co_await myWebSocket->asyncWriteOneMessage ("short");
+              auto const shortResponse = co_await myWebSocket->asyncReadOneMessage ();
+              success = longResponse == "a long response" && shortResponse == "short";
+              mockServer->shutDownUsingMockServerIoContext ();
+            },
+          "test");
+      ioContext.run ();
+      REQUIRE (success);
+    }
     SECTION ("mock server disconnects")
     {
       auto success = bool{};
@@ -176,4 +374,620 @@ TEST_CASE ("my_web_socket::SSLWebSocket")
   auto sslContext = boost::beast::net::ssl::context{ boost::beast::net::ssl::context::tlsv12_client };
   my_web_socket::test_load_client_certificate (sslContext);
   supperTest<my_web_socket::SSLWebSocket> (mockServerOption, [&sslContext] (auto port) -> boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > > { return createMySSLWebSocketClient (sslContext, { boost::asio::ip::make_address ("127.0.0.1"), port }); });
-}
\ No newline at end of file
+}
+TEST_CASE ("my_web_socket::MyWebSocketOption write queue limits")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto myWebSocketOption = my_web_socket::MyWebSocketOption{};
+  myWebSocketOption.maxQueuedMessages = 2;
+  auto makeMyWebSocket = [&ioContext, &myWebSocketOption] () { return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (my_web_socket::WebSocket{ ioContext }, "test", "0", myWebSocketOption); };
+  SECTION ("reject")
+  {
+    myWebSocketOption.slowConsumerPolicy = my_web_socket::SlowConsumerPolicy::reject;
+    auto myWebSocket = makeMyWebSocket ();
+    REQUIRE (myWebSocket->queueMessage ("1"));
+    REQUIRE (myWebSocket->queueMessage ("2"));
+    REQUIRE_FALSE (myWebSocket->queueMessage ("3"));
+    REQUIRE (myWebSocket->queueDepth () == 2);
+  }
+  SECTION ("dropNewest")
+  {
+    myWebSocketOption.slowConsumerPolicy = my_web_socket::SlowConsumerPolicy::dropNewest;
+    auto myWebSocket = makeMyWebSocket ();
+    myWebSocket->queueMessage ("1");
+    myWebSocket->queueMessage ("2");
+    REQUIRE (myWebSocket->queueMessage ("3"));
+    REQUIRE (myWebSocket->queueDepth () == 2);
+    REQUIRE (myWebSocket->droppedMessageCount () == 1);
+  }
+  SECTION ("dropOldest")
+  {
+    myWebSocketOption.slowConsumerPolicy = my_web_socket::SlowConsumerPolicy::dropOldest;
+    auto myWebSocket = makeMyWebSocket ();
+    myWebSocket->queueMessage ("1");
+    myWebSocket->queueMessage ("22");
+    REQUIRE (myWebSocket->queueMessage ("333"));
+    ioContext.poll (); // oldest messages get dropped on the executor
+    REQUIRE (myWebSocket->queueDepth () == 2);
+    REQUIRE (myWebSocket->queuedByteCount () == 5);
+    REQUIRE (myWebSocket->droppedMessageCount () == 1);
+  }
+  SECTION ("maxQueuedBytes")
+  {
+    myWebSocketOption.maxQueuedMessages = std::nullopt;
+    myWebSocketOption.maxQueuedBytes = 3;
+    auto myWebSocket = makeMyWebSocket ();
+    REQUIRE (myWebSocket->queueMessage ("12"));
+    REQUIRE_FALSE (myWebSocket->queueMessage ("34"));
+    REQUIRE (myWebSocket->queueMessage ("5"));
+    REQUIRE (myWebSocket->queuedByteCount () == 3);
+  }
+  SECTION ("close")
+  {
+    myWebSocketOption.slowConsumerPolicy = my_web_socket::SlowConsumerPolicy::close;
+    auto queued = true;
+    auto closeCode = std::optional<std::uint16_t>{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&myWebSocketOption, &queued, &closeCode] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (myWebSocketOption);
+            server->queueMessage ("1");
+            server->queueMessage ("2");
+            queued = server->queueMessage ("3");
+            try
+              {
+                co_await client->asyncReadOneMessage ();
+              }
+            catch (boost::system::system_error const &e)
+              {
+                if (e.code () == boost::beast::websocket::error::closed) closeCode = client->closeReason ().code;
+              }
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE_FALSE (queued);
+    REQUIRE (closeCode == boost::beast::websocket::close_code::policy_error);
+  }
+}
+
+// queues messageCount numbered messages on the server before its writeLoop starts so writeLoop finds them as one burst. returns what the client read
+template <typename U>
+std::vector<std::string>
+readBurstFromServer (U const &createConnectedWebSockets, my_web_socket::MyWebSocketOption const &serverOption, size_t messageCount)
+{
+  auto ioContext = boost::asio::io_context{};
+  auto readResult = std::vector<std::string>{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&createConnectedWebSockets, &serverOption, &readResult, messageCount] () -> boost::asio::awaitable<void>
+        {
+          auto [server, client] = co_await createConnectedWebSockets (serverOption);
+          for (auto i = size_t{}; i < messageCount; ++i)
+            server->queueMessage ("message " + std::to_string (i));
+          my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->writeLoop () && server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+          for (auto i = size_t{}; i < messageCount; ++i)
+            readResult.push_back (co_await client->asyncReadOneMessage ());
+          co_await client->asyncClose ();
+        },
+      "test");
+  ioContext.run ();
+  return readResult;
+}
+
+TEST_CASE ("my_web_socket::MyWebSocketOption flushMode batched")
+{
+  constexpr auto messageCount = size_t{ 100 };
+  auto serverOption = my_web_socket::MyWebSocketOption{};
+  serverOption.flushMode = my_web_socket::FlushMode::batched;
+  auto expected = std::vector<std::string>{};
+  for (auto i = size_t{}; i < messageCount; ++i)
+    expected.push_back ("message " + std::to_string (i));
+  SECTION ("WebSocket")
+  {
+    auto readResult = readBurstFromServer ([] (my_web_socket::MyWebSocketOption const &option) { return createConnectedMyWebSockets (option); }, serverOption, messageCount);
+    REQUIRE (readResult == expected);
+  }
+  SECTION ("SSLWebSocket")
+  {
+    auto serverSslContext = boost::beast::net::ssl::context{ boost::asio::ssl::context_base::method::tls_server };
+    my_web_socket::test_load_server_certificate (serverSslContext);
+    auto clientSslContext = boost::beast::net::ssl::context{ boost::beast::net::ssl::context::tlsv12_client };
+    my_web_socket::test_load_client_certificate (clientSslContext);
+    auto readResult = readBurstFromServer ([&serverSslContext, &clientSslContext] (my_web_socket::MyWebSocketOption const &option) { return createConnectedMySSLWebSockets (serverSslContext, clientSslContext, option); }, serverOption, messageCount);
+    REQUIRE (readResult == expected);
+  }
+}
+
+TEST_CASE ("my_web_socket::MyWebSocketOption memoryBudget")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto serverOption = my_web_socket::MyWebSocketOption{};
+  serverOption.memoryBudget = 64;
+  auto closeCode = std::optional<std::uint16_t>{};
+  SECTION ("inbound message")
+  {
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&serverOption, &closeCode] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (serverOption);
+            my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            co_await client->asyncWriteOneMessage (std::string (100, 'a'));
+            try
+              {
+                co_await client->asyncReadOneMessage ();
+              }
+            catch (boost::system::system_error const &e)
+              {
+                if (e.code () == boost::beast::websocket::error::closed) closeCode = client->closeReason ().code;
+              }
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (closeCode == boost::beast::websocket::close_code::too_big);
+  }
+  SECTION ("inbound message just under the budget")
+  {
+    auto serverReadResult = std::string{};
+    auto clientReadResult = std::string{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&serverOption, &serverReadResult, &clientReadResult] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (serverOption);
+            co_await client->asyncWriteOneMessage (std::string (60, 'a'));
+            serverReadResult = co_await server->asyncReadOneMessage ();
+            my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->writeLoop (), "test server", [server] (auto) {});
+            server->queueMessage (std::string (60, 'b')); // the read message is not held anymore so it does not count against the budget
+            clientReadResult = co_await client->asyncReadOneMessage ();
+            co_await client->asyncClose ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (serverReadResult == std::string (60, 'a'));
+    REQUIRE (clientReadResult == std::string (60, 'b'));
+  }
+  SECTION ("queueMessage")
+  {
+    auto queued = true;
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&serverOption, &closeCode, &queued] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (serverOption);
+            my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->writeLoop () && server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            queued = server->queueMessage (std::string (100, 'a'));
+            try
+              {
+                co_await client->asyncReadOneMessage ();
+              }
+            catch (boost::system::system_error const &e)
+              {
+                if (e.code () == boost::beast::websocket::error::closed) closeCode = client->closeReason ().code;
+              }
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE_FALSE (queued);
+    REQUIRE (closeCode == boost::beast::websocket::close_code::too_big);
+  }
+}
+
+TEST_CASE ("my_web_socket::MyWebSocketOption maxOutboundFrameSize")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto serverOption = my_web_socket::MyWebSocketOption{};
+  auto clientOption = my_web_socket::MyWebSocketOption{};
+  SECTION ("message arrives complete")
+  {
+    serverOption.maxOutboundFrameSize = 10;
+    auto const message = std::string (95, 'a') + "bcdef";
+    auto readResult = std::string{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&serverOption, &message, &readResult] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (serverOption);
+            co_await server->asyncWriteOneMessage (message);
+            readResult = co_await client->asyncReadOneMessage ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (readResult == message);
+  }
+  SECTION ("ping goes out between the frames of a big message")
+  {
+    serverOption.maxOutboundFrameSize = 1024;
+    serverOption.pingInterval = std::chrono::milliseconds{ 1 };
+    clientOption.maxMessageSize = 64 * 1024 * 1024;
+    auto roundTripTimeWhenWritten = std::optional<std::chrono::nanoseconds>{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&serverOption, &clientOption, &roundTripTimeWhenWritten] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (serverOption, clientOption);
+            auto executor = co_await boost::asio::this_coro::executor;
+            my_web_socket::coSpawnTraced (
+                executor,
+                [server, &roundTripTimeWhenWritten] () -> boost::asio::awaitable<void>
+                  {
+                    co_await server->asyncWriteOneMessage (std::string (32 * 1024 * 1024, 'a')); // more than the socket buffers hold so the write waits for the client
+                    roundTripTimeWhenWritten = server->roundTripTime ();
+                  }(),
+                "test server write");
+            my_web_socket::coSpawnTraced (executor, server->sendPingToEndpoint () && server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            auto timer = boost::asio::steady_timer{ executor, std::chrono::milliseconds{ 20 } };
+            co_await timer.async_wait (boost::asio::use_awaitable); // the ping waits for the write lock of the big message
+            co_await client->asyncReadOneMessage (); // answers the ping when it reads it. without fragments the ping would only go out after the whole message
+            co_await client->asyncClose ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (roundTripTimeWhenWritten.has_value ());
+  }
+}
+
+TEST_CASE ("my_web_socket::MyWebSocket readLoopWithOpcode binary message")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto const message = std::vector<std::byte>{ std::byte{ 0x00 }, std::byte{ 0xff }, std::byte{ 0xfe }, std::byte{ 0x7f } }; // not valid utf-8
+  auto readOpcode = std::optional<my_web_socket::Opcode>{};
+  auto readResult = std::vector<std::byte>{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&message, &readOpcode, &readResult] () -> boost::asio::awaitable<void>
+        {
+          auto [server, client] = co_await createConnectedMyWebSockets ();
+          auto executor = co_await boost::asio::this_coro::executor;
+          my_web_socket::coSpawnTraced (executor,
+                                        client->readLoopWithOpcode (
+                                            [&readOpcode, &readResult, client, executor] (my_web_socket::Opcode opcode, std::span<std::byte const> readMessage)
+                                              {
+                                                readOpcode = opcode;
+                                                readResult.assign (readMessage.begin (), readMessage.end ());
+                                                my_web_socket::coSpawnTraced (executor, client->asyncClose (), "test close");
+                                              }),
+                                        "test", [client] (auto) {});
+          co_await server->asyncWriteOneBinaryMessage (message);
+        },
+      "test");
+  ioContext.run ();
+  REQUIRE (readOpcode == my_web_socket::Opcode::binary);
+  REQUIRE (readResult == message);
+}
+
+TEST_CASE ("my_web_socket::MyWebSocketOption minCompressedMessageSize with permessage-deflate")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto serverOption = my_web_socket::MyWebSocketOption{};
+  serverOption.minCompressedMessageSize = 64;
+  auto const smallMessage = std::string{ R"({"price":1})" };
+  auto const bigMessage = std::string (1000, 'a');
+  auto readResults = std::vector<std::string>{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&serverOption, &smallMessage, &bigMessage, &readResults] () -> boost::asio::awaitable<void>
+        {
+          auto [server, client] = co_await createConnectedMyWebSockets (serverOption, {}, boost::beast::websocket::permessage_deflate{ .server_enable = true, .client_enable = true });
+          co_await server->asyncWriteOneMessage (smallMessage);
+          co_await server->asyncWriteOneMessage (bigMessage);
+          co_await client->asyncWriteOneMessage (bigMessage);
+          readResults.push_back (co_await client->asyncReadOneMessage ());
+          readResults.push_back (co_await client->asyncReadOneMessage ());
+          readResults.push_back (co_await server->asyncReadOneMessage ());
+        },
+      "test");
+  ioContext.run ();
+  REQUIRE (readResults == std::vector<std::string>{ smallMessage, bigMessage, bigMessage });
+}
+
+TEST_CASE ("my_web_socket::MyWebSocket queueTrackedMessage")
+{
+  auto ioContext = boost::asio::io_context{};
+  SECTION ("completes after the message was written")
+  {
+    auto written = bool{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&written] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets ();
+            my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->writeLoop () && server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            auto writeCompletion = server->queueTrackedMessage ("my message");
+            co_await writeCompletion->asyncWait ();
+            written = true;
+            co_await client->asyncClose ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (written);
+  }
+  SECTION ("fails if the message gets rejected")
+  {
+    auto myWebSocketOption = my_web_socket::MyWebSocketOption{};
+    myWebSocketOption.maxQueuedMessages = 0;
+    auto myWebSocket = std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (my_web_socket::WebSocket{ ioContext }, "test", "0", myWebSocketOption);
+    auto error = boost::system::error_code{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [writeCompletion = myWebSocket->queueTrackedMessage ("my message"), &error] () -> boost::asio::awaitable<void>
+          {
+            try
+              {
+                co_await writeCompletion->asyncWait ();
+              }
+            catch (boost::system::system_error const &e)
+              {
+                error = e.code ();
+              }
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (error == boost::asio::error::operation_aborted);
+  }
+  SECTION ("fails if the connection gets destroyed before the message was written")
+  {
+    auto myWebSocket = std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (my_web_socket::WebSocket{ ioContext }, "test", "0");
+    auto writeCompletion = myWebSocket->queueTrackedMessage ("my message");
+    ioContext.poll ();
+    myWebSocket.reset ();
+    auto error = boost::system::error_code{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [writeCompletion, &error] () -> boost::asio::awaitable<void>
+          {
+            try
+              {
+                co_await writeCompletion->asyncWait ();
+              }
+            catch (boost::system::system_error const &e)
+              {
+                error = e.code ();
+              }
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (error == boost::asio::error::operation_aborted);
+  }
+  SECTION ("fails if the connection closes before the message was written")
+  {
+    auto error = boost::system::error_code{};
+    auto queuedAfterClose = true;
+    auto server = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&error, &queuedAfterClose, &server] () -> boost::asio::awaitable<void>
+          {
+            auto [connectedServer, client] = co_await createConnectedMyWebSockets ();
+            server = connectedServer; // stays alive after the close so only the close can fail the completion
+            auto writeCompletion = server->queueTrackedMessage ("my message"); // no writeLoop so it stays queued
+            co_await server->asyncClose ();
+            queuedAfterClose = server->queueMessage ("after close");
+            try
+              {
+                co_await writeCompletion->asyncWait ();
+              }
+            catch (boost::system::system_error const &e)
+              {
+                error = e.code ();
+              }
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (error == boost::asio::error::operation_aborted);
+    REQUIRE_FALSE (queuedAfterClose);
+    REQUIRE (server->queueDepth () == 0);
+  }
+}
+
+TEST_CASE ("my_web_socket::MyWebSocketOption pingInterval and pongTimeout")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto myWebSocketOption = my_web_socket::MyWebSocketOption{};
+  myWebSocketOption.pingInterval = std::chrono::milliseconds{ 100 };
+  SECTION ("pong sets round trip time")
+  {
+    auto roundTripTime = std::optional<std::chrono::nanoseconds>{};
+    auto smoothedRoundTripTime = std::optional<std::chrono::nanoseconds>{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&myWebSocketOption, &roundTripTime, &smoothedRoundTripTime] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (myWebSocketOption);
+            auto executor = co_await boost::asio::this_coro::executor;
+            my_web_socket::coSpawnTraced (executor, server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            my_web_socket::coSpawnTraced (executor, client->readLoop ([] (auto) {}), "test client", [client] (auto) {});
+            server->pingEndpointPeriodically ();
+            auto timer = boost::asio::steady_timer{ executor, std::chrono::milliseconds{ 500 } };
+            co_await timer.async_wait (boost::asio::use_awaitable);
+            roundTripTime = server->roundTripTime ();
+            smoothedRoundTripTime = server->smoothedRoundTripTime ();
+            co_await client->asyncClose ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (roundTripTime);
+    REQUIRE (smoothedRoundTripTime);
+  }
+  SECTION ("whenIdle pings only after nothing got read for pingInterval")
+  {
+    myWebSocketOption.keepaliveMode = my_web_socket::KeepaliveMode::whenIdle;
+    auto roundTripTimeWhileBusy = std::optional<std::chrono::nanoseconds>{};
+    auto roundTripTimeAfterIdle = std::optional<std::chrono::nanoseconds>{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&myWebSocketOption, &roundTripTimeWhileBusy, &roundTripTimeAfterIdle] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets (myWebSocketOption);
+            auto executor = co_await boost::asio::this_coro::executor;
+            my_web_socket::coSpawnTraced (executor, server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            my_web_socket::coSpawnTraced (executor, client->readLoop ([] (auto) {}), "test client", [client] (auto) {});
+            server->pingEndpointPeriodically ();
+            auto timer = boost::asio::steady_timer{ executor };
+            for (auto i = 0; i < 25; ++i)
+              {
+                co_await client->asyncWriteOneMessage ("busy");
+                timer.expires_after (std::chrono::milliseconds{ 20 });
+                co_await timer.async_wait (boost::asio::use_awaitable);
+              }
+            roundTripTimeWhileBusy = server->roundTripTime ();
+            timer.expires_after (std::chrono::milliseconds{ 400 });
+            co_await timer.async_wait (boost::asio::use_awaitable);
+            roundTripTimeAfterIdle = server->roundTripTime ();
+            co_await client->asyncClose ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE_FALSE (roundTripTimeWhileBusy);
+    REQUIRE (roundTripTimeAfterIdle);
+  }
+  SECTION ("missing pong closes the connection")
+  {
+    myWebSocketOption.pongTimeout = std::chrono::milliseconds{ 100 };
+    auto serverReadLoopEnded = bool{};
+    auto client = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&myWebSocketOption, &serverReadLoopEnded, &client] () -> boost::asio::awaitable<void>
+          {
+            auto [server, connectedClient] = co_await createConnectedMyWebSockets (myWebSocketOption);
+            client = connectedClient; // client does not read so it never answers the ping
+            my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->readLoop ([] (auto) {}), "test server", [server, &serverReadLoopEnded] (auto) { serverReadLoopEnded = true; });
+            server->pingEndpointPeriodically ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (serverReadLoopEnded);
+  }
+  SECTION ("close cancels the pings on the timer wheel")
+  {
+    myWebSocketOption.pingInterval = std::chrono::seconds{ 60 };
+    auto server = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&myWebSocketOption, &server] () -> boost::asio::awaitable<void>
+          {
+            auto [connectedServer, client] = co_await createConnectedMyWebSockets (myWebSocketOption);
+            server = connectedServer; // stays alive after the close so only the close can cancel the ping
+            server->pingEndpointPeriodically ();
+            co_await server->asyncClose ();
+          },
+        "test");
+    auto const start = std::chrono::steady_clock::now ();
+    ioContext.run ();
+    REQUIRE (std::chrono::steady_clock::now () - start < myWebSocketOption.pingInterval);
+    REQUIRE (my_web_socket::TimerWheel::of (ioContext.get_executor ()).scheduledCount () == 0);
+  }
+}
+
+TEST_CASE ("my_web_socket::MyWebSocketOption hibernateAfter")
+{
+  auto ioContext = boost::asio::io_context{};
+  auto clientOption = my_web_socket::MyWebSocketOption{};
+  clientOption.hibernateAfter = std::chrono::milliseconds{ 100 };
+  auto hibernatedWhileIdle = bool{};
+  auto hibernatedAfterMessage = bool{};
+  auto messagesRead = std::vector<std::string>{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&clientOption, &hibernatedWhileIdle, &hibernatedAfterMessage, &messagesRead] () -> boost::asio::awaitable<void>
+        {
+          auto [server, client] = co_await createConnectedMyWebSockets ({}, clientOption);
+          auto executor = co_await boost::asio::this_coro::executor;
+          my_web_socket::coSpawnTraced (executor, client->readLoop ([&messagesRead] (std::string message) { messagesRead.push_back (std::move (message)); }), "test client", [client] (auto) {});
+          co_await server->asyncWriteOneMessage (std::string (1000, 'a'));
+          auto timer = boost::asio::steady_timer{ executor, std::chrono::milliseconds{ 400 } };
+          co_await timer.async_wait (boost::asio::use_awaitable);
+          hibernatedWhileIdle = client->isHibernating ();
+          co_await server->asyncWriteOneMessage ("b");
+          timer.expires_after (std::chrono::milliseconds{ 10 });
+          co_await timer.async_wait (boost::asio::use_awaitable);
+          hibernatedAfterMessage = client->isHibernating ();
+          co_await server->asyncClose ();
+        },
+      "test");
+  ioContext.run ();
+  REQUIRE (hibernatedWhileIdle);
+  REQUIRE_FALSE (hibernatedAfterMessage);
+  REQUIRE (messagesRead == std::vector<std::string>{ std::string (1000, 'a'), "b" });
+}
+
+TEST_CASE ("my_web_socket::MyWebSocket queueMessage with conflation key")
+{
+  auto ioContext = boost::asio::io_context{};
+  SECTION ("queue depth")
+  {
+    auto myWebSocket = std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (my_web_socket::WebSocket{ ioContext }, "test", "0");
+    myWebSocket->queueMessage ("a", "1");
+    myWebSocket->queueMessage ("b", "22");
+    myWebSocket->queueMessage ("a", "333");
+    myWebSocket->queueMessage ("not conflated");
+    ioContext.poll (); // messages get conflated on the executor
+    REQUIRE (myWebSocket->queueDepth () == 3);
+    REQUIRE (myWebSocket->queuedByteCount () == 18);
+  }
+  SECTION ("replacing message is written in place of the replaced one")
+  {
+    auto readResult = std::vector<std::string>{};
+    my_web_socket::coSpawnTraced (
+        ioContext,
+        [&readResult] () -> boost::asio::awaitable<void>
+          {
+            auto [server, client] = co_await createConnectedMyWebSockets ();
+            server->queueMessage ("a", "1");
+            server->queueMessage ("22");
+            server->queueMessage ("a", "333");
+            server->queueMessage ("b", "4444");
+            server->queueMessage ("high", my_web_socket::Priority::high);
+            server->queueMessage ("b", "55555", my_web_socket::Priority::high); // keeps the normal priority of "4444"
+            my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, server->writeLoop () && server->readLoop ([] (auto) {}), "test server", [server] (auto) {});
+            for (auto i = 0; i < 4; ++i)
+              readResult.push_back (co_await client->asyncReadOneMessage ());
+            co_await client->asyncClose ();
+          },
+        "test");
+    ioContext.run ();
+    REQUIRE (readResult == std::vector<std::string>{ "high", "333", "22", "55555" });
+  }
+}
+
+TEST_CASE ("my_web_socket::MyWebSocket queueMessage from multiple threads")
+{
+  constexpr auto producerCount = size_t{ 4 };
+  constexpr auto messagesPerProducer = size_t{ 1'000 };
+  auto ioContext = boost::asio::io_context{};
+  auto messagesReceived = size_t{};
+  std::unique_ptr<my_web_socket::MockServer<my_web_socket::WebSocket> > mockServer;
+  auto mockServerOption = my_web_socket::MockServerOption{};
+  mockServerOption.callOnMessageStartsWith["message"] = [&messagesReceived, &mockServer] ()
+    {
+      if (++messagesReceived == producerCount * messagesPerProducer) mockServer->shutDownUsingMockServerIoContext ();
+    };
+  mockServer = std::make_unique<my_web_socket::MockServer<my_web_socket::WebSocket> > (boost::asio::ip::tcp::endpoint{ boost::asio::ip::tcp::v4 (), 0 }, mockServerOption, "mock_server_test", "0");
+  auto myWebSocket = std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >{};
+  my_web_socket::coSpawnTraced (
+      ioContext,
+      [&myWebSocket, port = mockServer->getPort ()] () -> boost::asio::awaitable<void>
+        {
+          auto connectedWebSocket = co_await createMyWebSocket ({ boost::asio::ip::make_address ("127.0.0.1"), port });
+          my_web_socket::coSpawnTraced (co_await boost::asio::this_coro::executor, connectedWebSocket->writeLoop () && connectedWebSocket->readLoop ([] (auto) {}), "test", [connectedWebSocket] (auto) {});
+          myWebSocket = connectedWebSocket;
+        },
+      "test");
+  while (not myWebSocket)
+    ioContext.run_one ();
+  auto producers = std::vector<std::thread>{};
+  for (auto i = size_t{}; i < producerCount; ++i)
+    producers.emplace_back (
+        [&myWebSocket] ()
+          {
+            for (auto j = size_t{}; j < messagesPerProducer; ++j)
+              myWebSocket->queueMessage ("message");
+          });
+  ioContext.run ();
+  for (auto &producer : producers)
+    producer.join ();
+  mockServer.reset ();
+  REQUIRE (messagesReceived == producerCount * messagesPerProducer);
+}
@@ -0,0 +1,55 @@
+#include "my_web_socket/timerWheel.hxx"
+#include <boost/asio/io_context.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+TEST_CASE ("timerWheel")
+{
+  auto ioContext = boost::asio::io_context{};
+  SECTION ("one wheel per execution context")
+  {
+    auto otherIoContext = boost::asio::io_context{};
+    REQUIRE (&my_web_socket::TimerWheel::of (ioContext.get_executor ()) == &my_web_socket::TimerWheel::of (ioContext.get_executor ()));
+    REQUIRE (&my_web_socket::TimerWheel::of (ioContext.get_executor ()) != &my_web_socket::TimerWheel::of (otherIoContext.get_executor ()));
+  }
+  SECTION ("callbacks run in order of their delay")
+  {
+    auto &timerWheel = my_web_socket::TimerWheel::of (ioContext.get_executor ());
+    auto expired = std::vector<int>{};
+    timerWheel.schedule (std::chrono::milliseconds{ 300 }, [&expired] () { expired.push_back (3); });
+    timerWheel.schedule (std::chrono::milliseconds{ 0 }, [&expired] () { expired.push_back (1); });
+    timerWheel.schedule (std::chrono::milliseconds{ 150 }, [&expired] () { expired.push_back (2); });
+    REQUIRE (timerWheel.scheduledCount () == 3);
+    ioContext.run ();
+    REQUIRE (expired == std::vector<int>{ 1, 2, 3 });
+    REQUIRE (timerWheel.scheduledCount () == 0);
+  }
+  SECTION ("cancelled callback does not run")
+  {
+    auto &timerWheel = my_web_socket::TimerWheel::of (ioContext.get_executor ());
+    auto expired = bool{};
+    auto const entryId = timerWheel.schedule (std::chrono::seconds{ 60 }, [&expired] () { expired = true; });
+    REQUIRE (timerWheel.cancel (entryId));
+    REQUIRE_FALSE (timerWheel.cancel (entryId));
+    REQUIRE (timerWheel.scheduledCount () == 0);
+    auto const start = std::chrono::steady_clock::now ();
+    ioContext.run ();
+    REQUIRE (std::chrono::steady_clock::now () - start < my_web_socket::TimerWheel::tickDuration); // the wheel stopped ticking
+    REQUIRE_FALSE (expired);
+  }
+  SECTION ("callback can schedule again")
+  {
+    auto &timerWheel = my_web_socket::TimerWheel::of (ioContext.get_executor ());
+    auto expiredCount = 0;
+    auto onExpiry = std::function<void ()>{};
+    onExpiry = [&expiredCount, &timerWheel, &onExpiry] ()
+      {
+        if (++expiredCount < 3) timerWheel.schedule (my_web_socket::TimerWheel::tickDuration, onExpiry);
+      };
+    timerWheel.schedule (my_web_socket::TimerWheel::tickDuration, onExpiry);
+    ioContext.run ();
+    REQUIRE (expiredCount == 3);
+  }
+}
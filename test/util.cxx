@@ -1,16 +1,17 @@
 #include "util.hxx"
 
 boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >
-createMyWebSocket (boost::asio::ip::tcp::endpoint endpoint)
+createMyWebSocket (boost::asio::ip::tcp::endpoint endpoint, my_web_socket::MyWebSocketOption myWebSocketOption, std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate)
 {
   auto webSocket = my_web_socket::WebSocket{ co_await boost::asio::this_coro::executor };
+  if (permessageDeflate) webSocket.set_option (permessageDeflate.value ());
   co_await boost::beast::get_lowest_layer (webSocket).async_connect (endpoint);
   co_await webSocket.async_handshake (endpoint.address ().to_string () + std::to_string (endpoint.port ()), "/");
-  co_return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (std::move (webSocket));
+  co_return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (std::move (webSocket), "client", "0", std::move (myWebSocketOption));
 }
 
 boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > >
-createMySSLWebSocketClient (boost::beast::net::ssl::context &ctx, boost::asio::ip::tcp::endpoint endpoint)
+createMySSLWebSocketClient (boost::beast::net::ssl::context &ctx, boost::asio::ip::tcp::endpoint endpoint, my_web_socket::MyWebSocketOption myWebSocketOption)
 {
   using namespace boost::asio;
   using namespace boost::beast;
@@ -21,5 +22,39 @@ createMySSLWebSocketClient (boost::beast::net::ssl::context &ctx, boost::asio::i
   co_await get_lowest_layer (sslWebSocket).async_connect (endpoint, use_awaitable);
   co_await sslWebSocket.next_layer ().async_handshake (ssl::stream_base::client, use_awaitable);
   co_await sslWebSocket.async_handshake ("localhost:" + std::to_string (endpoint.port ()), "/", use_awaitable);
-  co_return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > (std::move (sslWebSocket));
-}
\ No newline at end of file
+  co_return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > (std::move (sslWebSocket), "client", "0", std::move (myWebSocketOption));
+}
+
+boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > >
+acceptMyWebSocket (boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor> &acceptor, my_web_socket::MyWebSocketOption myWebSocketOption, std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate)
+{
+  auto webSocket = my_web_socket::WebSocket{ co_await acceptor.async_accept () };
+  if (permessageDeflate) webSocket.set_option (permessageDeflate.value ());
+  co_await webSocket.async_accept ();
+  co_return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > (std::move (webSocket), "server", "0", std::move (myWebSocketOption));
+}
+
+boost::asio::awaitable<std::tuple<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >, std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > > >
+createConnectedMyWebSockets (my_web_socket::MyWebSocketOption serverOption, my_web_socket::MyWebSocketOption clientOption, std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate)
+{
+  using namespace boost::asio::experimental::awaitable_operators;
+  auto acceptor = boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor>{ co_await boost::asio::this_coro::executor, { boost::asio::ip::make_address ("127.0.0.1"), 0 } };
+  co_return co_await (acceptMyWebSocket (acceptor, std::move (serverOption), permessageDeflate) && createMyWebSocket (acceptor.local_endpoint (), std::move (clientOption), permessageDeflate));
+}
+
+boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > >
+acceptMySSLWebSocket (boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor> &acceptor, boost::beast::net::ssl::context &sslContext, my_web_socket::MyWebSocketOption myWebSocketOption)
+{
+  auto webSocket = my_web_socket::SSLWebSocket{ co_await acceptor.async_accept (), sslContext };
+  co_await webSocket.next_layer ().async_handshake (boost::asio::ssl::stream_base::server, boost::asio::use_awaitable);
+  co_await webSocket.async_accept (boost::asio::use_awaitable);
+  co_return std::make_shared<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > (std::move (webSocket), "server", "0", std::move (myWebSocketOption));
+}
+
+boost::asio::awaitable<std::tuple<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> >, std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > > >
+createConnectedMySSLWebSockets (boost::beast::net::ssl::context &serverSslContext, boost::beast::net::ssl::context &clientSslContext, my_web_socket::MyWebSocketOption serverOption, my_web_socket::MyWebSocketOption clientOption)
+{
+  using namespace boost::asio::experimental::awaitable_operators;
+  auto acceptor = boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor>{ co_await boost::asio::this_coro::executor, { boost::asio::ip::make_address ("127.0.0.1"), 0 } };
+  co_return co_await (acceptMySSLWebSocket (acceptor, serverSslContext, std::move (serverOption)) && createMySSLWebSocketClient (clientSslContext, acceptor.local_endpoint (), std::move (clientOption)));
+}
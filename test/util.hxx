@@ -3,8 +3,14 @@
 #include "my_web_socket/mockServer.hxx"
 #include <boost/asio/co_spawn.hpp>
 
-boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > > createMyWebSocket (boost::asio::ip::tcp::endpoint endpoint);
-boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > > createMySSLWebSocketClient (boost::beast::net::ssl::context &ctx, boost::asio::ip::tcp::endpoint endpoint);
+boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > > createMyWebSocket (boost::asio::ip::tcp::endpoint endpoint, my_web_socket::MyWebSocketOption myWebSocketOption = {}, std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate = {});
+boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > > createMySSLWebSocketClient (boost::beast::net::ssl::context &ctx, boost::asio::ip::tcp::endpoint endpoint, my_web_socket::MyWebSocketOption myWebSocketOption = {});
+boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > > acceptMyWebSocket (boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor> &acceptor, my_web_socket::MyWebSocketOption myWebSocketOption = {}, std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate = {});
+// returns server and client side of a web socket connection on loopback. permessageDeflate gets offered by both sides
+boost::asio::awaitable<std::tuple<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> >, std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::WebSocket> > > > createConnectedMyWebSockets (my_web_socket::MyWebSocketOption serverOption = {}, my_web_socket::MyWebSocketOption clientOption = {}, std::optional<boost::beast::websocket::permessage_deflate> permessageDeflate = {});
+boost::asio::awaitable<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > > acceptMySSLWebSocket (boost::asio::use_awaitable_t<>::as_default_on_t<boost::asio::ip::tcp::acceptor> &acceptor, boost::beast::net::ssl::context &sslContext, my_web_socket::MyWebSocketOption myWebSocketOption = {});
+// returns server and client side of a ssl web socket connection on loopback
+boost::asio::awaitable<std::tuple<std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> >, std::shared_ptr<my_web_socket::MyWebSocket<my_web_socket::SSLWebSocket> > > > createConnectedMySSLWebSockets (boost::beast::net::ssl::context &serverSslContext, boost::beast::net::ssl::context &clientSslContext, my_web_socket::MyWebSocketOption serverOption = {}, my_web_socket::MyWebSocketOption clientOption = {});
 
 template <typename T>
 boost::asio::awaitable<void>